@@ -0,0 +1,89 @@
+#pragma once
+
+#include "camera.hpp"
+#include <filesystem>
+#include <vector>
+
+/**
+ * The scripted movement of a @link Camera defined by keyframes of its orbit parameters. The camera is linearly
+ * interpolated between the keyframes and it stays at the first (last) keyframe before (after) the path.
+ *
+ * The path can be loaded from a text file with one keyframe per line (the angles are in degrees, the lines starting
+ * with '#' are ignored):
+ * <code>
+ *  # time [ms]   direction   elevation   distance
+ *  0             -45         20          25
+ *  5000          45          10          15
+ * </code>
+ */
+class CameraPath {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** One keyframe of the path, the parameters match @link Camera::set_eye_position. */
+    struct Keyframe {
+        /** The time of the keyframe (in milliseconds). */
+        float time;
+        /** The direction angle (in radians). */
+        float angle_direction;
+        /** The elevation angle (in radians). */
+        float angle_elevation;
+        /** The distance from the origin. */
+        float distance;
+    };
+
+  protected:
+    /** The keyframes sorted by their time. */
+    std::vector<Keyframe> keyframes;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /** Constructs an empty @link CameraPath. */
+    CameraPath() = default;
+
+    /**
+     * Loads the path from a file (see the format above).
+     *
+     * @param 	file_path	The path to the file.
+     * @return	The loaded path, it is empty if the file could not be read.
+     */
+    static CameraPath from_file(const std::filesystem::path& file_path);
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Adds a keyframe; the keyframes may be added in any order.
+     *
+     * @param 	time		   	The time of the keyframe (in milliseconds).
+     * @param 	angle_direction	The direction angle (in radians).
+     * @param 	angle_elevation	The elevation angle (in radians).
+     * @param 	distance	   	The distance from the origin.
+     */
+    void add_keyframe(float time, float angle_direction, float angle_elevation, float distance);
+
+    /**
+     * Moves the camera to its position on the path at the specified time. Does nothing if the path is empty.
+     *
+     * @param 	time  	The time (in milliseconds).
+     * @param 	camera	The camera to move.
+     */
+    void apply(float time, Camera& camera) const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Checks if the path has no keyframes. */
+    bool empty() const { return keyframes.empty(); }
+
+    /** Returns the time of the last keyframe (in milliseconds). */
+    float get_duration() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+
+    /** Returns the keyframes sorted by their time. */
+    const std::vector<Keyframe>& get_keyframes() const { return keyframes; }
+};
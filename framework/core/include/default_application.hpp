@@ -3,6 +3,7 @@
 #include "capsule.hpp"
 #include "cube.hpp"
 #include "cylinder.hpp"
+#include "gpu_timer.hpp"
 #include "iapplication.hpp"
 #include "phong_material_ubo.hpp"
 #include "sphere.hpp"
@@ -25,15 +26,21 @@ protected:
     /** The elapsed time from the beginning (in milliseconds). */
     long double elapsed_time = 0;
 
-    /** The OpenGL query object that we use to get render time of one frame. */
-    GLuint render_time_query;
+    /** The timer measuring the GPU time of frames and passes without stalling the pipeline. */
+    GPUTimer gpu_timer;
 
     /** The current FPS on GPU. */
-    float fps_gpu;
+    float fps_gpu = 0.0f;
 
     /** The current FPS on CPU. */
     float fps_cpu;
 
+    /**
+     * The programs that are being linked in the background and the programs they replace once all of them are linked
+     * (see @link reload_program). Until then, the replaced programs are still used for rendering.
+     */
+    std::vector<std::pair<ShaderProgram*, ShaderProgram>> pending_programs;
+
     // ----------------------------------------------------------------------------
     // Variables (Geometry)
     // ----------------------------------------------------------------------------
@@ -107,6 +114,40 @@ public:
      */
     void compile_shaders() override;
 
+    /**
+     * Starts linking the program without waiting for it; the program replaces the target one in @link
+     * update_pending_programs.
+     *
+     * @param 	target     	The program to replace.
+     * @param 	new_program	The program with its shaders added but not linked yet.
+     */
+    void reload_program(ShaderProgram& target, ShaderProgram&& new_program);
+
+    /**
+     * Starts linking the program from the vertex and the fragment shader, see @link reload_program.
+     *
+     * @param 	target		   	The program to replace.
+     * @param 	vertex_shader  	The vertex shader.
+     * @param 	fragment_shader	The fragment shader.
+     */
+    void reload_program(ShaderProgram& target, const std::filesystem::path& vertex_shader, const std::filesystem::path& fragment_shader);
+
+    /**
+     * Starts linking the program from the compute shader, see @link reload_program.
+     *
+     * @param 	target		  	The program to replace.
+     * @param 	compute_shader	The compute shader.
+     */
+    void reload_compute_program(ShaderProgram& target, const std::filesystem::path& compute_shader);
+
+    /**
+     * Replaces the programs by the pending ones once all pending programs are linked. If any of them fails, the
+     * previous programs are kept (unless waiting, the new programs are used then since there may be no previous ones).
+     *
+     * @param 	wait	The flag determining if the method should wait for the pending programs.
+     */
+    void update_pending_programs(bool wait);
+
     // ----------------------------------------------------------------------------
     // Update
     // ----------------------------------------------------------------------------
@@ -116,6 +157,20 @@ public:
      */
     void update(float delta) override;
 
+    // ----------------------------------------------------------------------------
+    // Frame
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * {@copydoc IApplication::begin_frame}
+     */
+    void begin_frame() override;
+
+    /**
+     * {@copydoc IApplication::end_frame}
+     */
+    void end_frame() override;
+
     // ----------------------------------------------------------------------------
     // Render
     // ----------------------------------------------------------------------------
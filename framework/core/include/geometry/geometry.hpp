@@ -79,13 +79,13 @@ public:
      */
     Geometry(
         GLenum mode,
-        std::vector<float> positions,
-        std::vector<uint32_t> indices,
-        std::vector<float> normals = {},
-        std::vector<float> colors = {},
-        std::vector<float> tex_coords = {},
-        std::vector<float> tangents = {},
-        std::vector<float> bitangents = {},
+        const std::vector<float>& positions,
+        const std::vector<uint32_t>& indices,
+        const std::vector<float>& normals = {},
+        const std::vector<float>& colors = {},
+        const std::vector<float>& tex_coords = {},
+        const std::vector<float>& tangents = {},
+        const std::vector<float>& bitangents = {},
         GLint position_loc = DEFAULT_POSITION_LOC,
         GLint normal_loc = DEFAULT_NORMAL_LOC,
         GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC,
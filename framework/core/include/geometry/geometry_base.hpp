@@ -158,8 +158,8 @@ class Geometry_Base {
      * @param 	bitangent_loc	The location of bitangent vertex attribute for the VAO (use -1 if not necessary).
      * @param 	color_loc	 	The location of color vertex attribute for the VAO (use -1 if not necessary).
      */
-    Geometry_Base(GLenum mode, std::vector<float> positions, std::vector<uint32_t> indices, std::vector<float> normals, std::vector<float> colors, std::vector<float> tex_coords,
-                  std::vector<float> tangents, std::vector<float> bitangents, GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
+    Geometry_Base(GLenum mode, const std::vector<float>& positions, const std::vector<uint32_t>& indices, const std::vector<float>& normals, const std::vector<float>& colors,
+                  const std::vector<float>& tex_coords, const std::vector<float>& tangents, const std::vector<float>& bitangents, GLint position_loc = DEFAULT_POSITION_LOC, GLint normal_loc = DEFAULT_NORMAL_LOC,
                   GLint tex_coord_loc = DEFAULT_TEX_COORD_LOC, GLint tangent_loc = DEFAULT_TANGENT_LOC, GLint bitangent_loc = DEFAULT_BITANGENT_LOC, GLint color_loc = DEFAULT_COLOR_LOC);
     ;
 
@@ -74,6 +74,9 @@ class IApplication {
     /** The default camera. */
     Camera camera;
 
+    /** The frame buffer representing the window (0 is the window itself, an offscreen frame buffer in the headless mode). */
+    GLuint output_framebuffer = 0;
+
   public:
     // ----------------------------------------------------------------------------
     // Constructors
@@ -142,6 +145,16 @@ class IApplication {
      */
     virtual void compile_shaders() {}
 
+    // ----------------------------------------------------------------------------
+    // Frame
+    // ----------------------------------------------------------------------------
+
+    /** This method is invoked from within the infinite OpenGL loop at the beginning of each frame, before @link update. */
+    virtual void begin_frame() {}
+
+    /** This method is invoked from within the infinite OpenGL loop after the GUI is rendered, before swapping the buffers. */
+    virtual void end_frame() {}
+
     // ----------------------------------------------------------------------------
     // Update
     // ----------------------------------------------------------------------------
@@ -270,4 +283,17 @@ class IApplication {
      * @param 	window	The GLFW window to set.
      */
     void set_window(GLFWwindow* window);
+
+    /** Returns the default camera (e.g., to move it along a scripted path). */
+    Camera& get_camera();
+
+    /** Returns the frame buffer representing the window. */
+    GLuint get_output_framebuffer() const;
+
+    /**
+     * Sets the frame buffer into which the application renders its final image instead of the window.
+     *
+     * @param 	framebuffer	The frame buffer (0 is the window).
+     */
+    void set_output_framebuffer(GLuint framebuffer);
 };
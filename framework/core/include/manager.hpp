@@ -3,7 +3,36 @@
 #define GLFW_INCLUDE_NONE
 #include "GLFW/glfw3.h"
 #include "iapplication.hpp"
+#include <filesystem>
+#include <functional>
 #include <string>
+#include <vector>
+
+/** The settings of the offline (headless) rendering parsed from the command line. */
+struct OfflineSettings {
+    /** The flag determining if the application should render offline (--headless). */
+    bool enabled = false;
+    /** The number of rendered frames (--frames N). */
+    int frames = 1;
+    /** The fixed time step between two frames in milliseconds (--frame-time MS). */
+    float frame_time = 1000.0f / 60.0f;
+    /**
+     * The output image (--output FILE), '.hdr' stores the linear floating point values, any other extension a PNG. If
+     * more frames are rendered, the frame number is appended to the file name (e.g., 'frame_0007.png'). No images are
+     * saved if empty.
+     */
+    std::filesystem::path output = "frame.png";
+    /** The camera path (--camera-path FILE, see @link CameraPath), the camera is not moved if empty. */
+    std::filesystem::path camera_path;
+
+    /**
+     * Parses the settings from the command-line arguments, unknown arguments are ignored.
+     *
+     * @param 	arguments	The command-line arguments.
+     * @return	The parsed settings.
+     */
+    static OfflineSettings from_arguments(const std::vector<std::string>& arguments);
+};
 
 /**
  * This is a factory class that allows us to easily initialize the OpenGL context.
@@ -28,6 +57,9 @@ class OpenGLManager {
     /** The number of sampling points per fragment, to be used with GLFW_SAMPLES. */
     int samples_per_pixel = 1;
 
+    /** The flag determining if the context should be created without a visible window (and without a display). */
+    bool headless = false;
+
     // ----------------------------------------------------------------------------
     // Methods
     // ----------------------------------------------------------------------------
@@ -46,6 +78,17 @@ class OpenGLManager {
     /** This method invokes an infinite loop and renders the provided application every frame. */
     void run(IApplication& application);
 
+    /**
+     * Renders the specified number of frames into an offscreen frame buffer with a fixed time step and saves them into
+     * images. The GUI is not rendered.
+     *
+     * @param 	application	The application to render.
+     * @param 	settings   	The settings of the offline rendering.
+     * @param 	on_frame   	The optional callback invoked after each frame with the frame number (e.g., to collect timings).
+     * @return	@p true if all images were saved, @p false otherwise.
+     */
+    bool run_offline(IApplication& application, const OfflineSettings& settings, const std::function<void(int)>& on_frame = {});
+
     /** Terminates the GLFW and free the allocated resource.  */
     void terminate();
 
@@ -145,4 +188,13 @@ class OpenGLManager {
      * @param 	samples 	The number of sampling points per pixel.
      */
     void set_multisampling_per_pixel(int samples) { samples_per_pixel = samples; }
+
+    /**
+     * Requests a context without a visible window; it must be called before @link init. With GLFW 3.4 or newer, the
+     * context is created on the null platform through EGL (or OSMesa), hence no display is needed and, e.g., Mesa
+     * llvmpipe can be used on machines without a GPU. Older GLFW versions only hide the window.
+     *
+     * @param 	headless	The flag determining if the context should be headless.
+     */
+    void set_headless(bool headless) { this->headless = headless; }
 };
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <string>
+#include <vector>
+
+/** The duration of one named pass measured on GPU. */
+struct GPUPassTime {
+    /** The name of the pass. */
+    std::string name;
+    /** The beginning of the pass relative to the beginning of its frame (in milliseconds). */
+    float start;
+    /** The duration of the pass (in milliseconds). */
+    float time;
+};
+
+/**
+ * Measures the GPU time of frames and of named passes inside them using GL_TIMESTAMP queries. The queries of each
+ * frame are stored in a ring of frames and they are read back only when the frame slot is reused, i.e., several
+ * frames later, when the GPU has already finished them. Hence, unlike glFinish followed by reading GL_TIME_ELAPSED,
+ * the measurement does not stall the pipeline and the reported times are @link get_latency frames old.
+ *
+ * Usage:
+ * <code>
+ *  timer.begin_frame();
+ *  timer.begin_pass("Scene");
+ *  ...
+ *  timer.end_pass();
+ *  timer.end_frame();
+ * </code>
+ */
+class GPUTimer {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The pass recorded in a frame, it references the indices of its timestamps in the frame. */
+    struct Pass {
+        std::string name;
+        int begin;
+        int end;
+    };
+
+    /** The queries recorded in one frame. */
+    struct Frame {
+        /** The pooled query objects, they are created on demand and reused in the following frames. */
+        std::vector<GLuint> queries;
+        /** The number of queries recorded in the frame. */
+        int used = 0;
+        /** The passes recorded in the frame. */
+        std::vector<Pass> passes;
+        /** The flag determining if the frame was recorded and it has not been read back yet. */
+        bool pending = false;
+    };
+
+    /** The ring of frames. */
+    std::vector<Frame> frames;
+
+    /** The index of the frame that is being recorded. */
+    int current = 0;
+
+    /** The indices (into @link Frame::passes) of the passes that have begun but not ended yet. */
+    std::vector<int> open_passes;
+
+    /** The GPU timestamp of the beginning of the last frame that was read back (in nanoseconds). */
+    GLuint64 frame_timestamp = 0;
+
+    /** The duration of the last frame that was read back (in milliseconds). */
+    float frame_time = 0.0f;
+
+    /** The durations of the passes of the last frame that was read back. */
+    std::vector<GPUPassTime> pass_times;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Constructs a new @link GPUTimer. No OpenGL objects are created until the first frame begins.
+     *
+     * @param 	latency	The number of frames between recording the queries and reading them back.
+     */
+    explicit GPUTimer(int latency = 3);
+
+    /** Destroys this @link GPUTimer and deletes the query objects. */
+    ~GPUTimer();
+
+    GPUTimer(const GPUTimer&) = delete;
+    GPUTimer& operator=(const GPUTimer&) = delete;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Begins a new frame. Reads back the results of the frame that previously occupied the slot in the ring (it
+     * blocks only if the GPU is more than @link get_latency frames behind).
+     *
+     * @return	@p true if the results of an older frame were read back, @p false otherwise.
+     */
+    bool begin_frame();
+
+    /** Ends the current frame; the passes that are still open end with it. */
+    void end_frame();
+
+    /**
+     * Begins a named pass. The passes may be nested, in which case the time of the inner pass is included in the
+     * time of the outer one.
+     *
+     * @param 	name	The name of the pass.
+     */
+    void begin_pass(const std::string& name);
+
+    /** Ends the last pass that began. */
+    void end_pass();
+
+  protected:
+    /** Records a timestamp into the current frame and returns its index. */
+    int record_timestamp();
+
+    /** Reads back the results of the specified frame. */
+    void resolve(Frame& frame);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the number of frames between recording the queries and reading them back. */
+    int get_latency() const { return static_cast<int>(frames.size()) - 1; }
+
+    /** Returns the GPU timestamp of the beginning of the last frame that was read back (in nanoseconds). */
+    GLuint64 get_frame_timestamp() const { return frame_timestamp; }
+
+    /** Returns the duration of the last frame that was read back (in milliseconds), zero if there is none yet. */
+    float get_frame_time() const { return frame_time; }
+
+    /** Returns the durations of the passes of the last frame that was read back, in the order they began. */
+    const std::vector<GPUPassTime>& get_pass_times() const { return pass_times; }
+
+    /**
+     * Returns the durations of the passes of the last frame that was read back with the passes of the same name
+     * merged, e.g., the stages repeated in a loop. The passes are in the order their names first began, the start of
+     * a merged pass is the start of its first occurrence and its time is the sum of the times of all occurrences.
+     */
+    std::vector<GPUPassTime> get_total_pass_times() const;
+};
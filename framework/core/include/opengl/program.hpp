@@ -29,6 +29,9 @@
  * if (my_program.is_valid()) {
  *     my_program.use();
  * }
+ *
+ * If a cache directory is set (see @link ShaderProgram::set_binary_cache_directory), the linked programs are stored
+ * there as program binaries and the next link of the same sources loads the binary instead of compiling the shaders.
  * @author	<a href="mailto:jan.byska@gmail.com">Jan Byška</a>
  * @author	<a href="mailto:cejka.honza@gmail.com">Jan Čejka</a>
  * @author	<a href="mailto:matus.talcik@mail.muni.cz">Matúš Talčík</a>
@@ -47,6 +50,15 @@ protected:
     /** The flag that is @p true if this shader is ready to be used. */
     bool valid;
 
+    /** The path to the cached binary of the program that is being linked, empty if the cache is disabled. */
+    std::filesystem::path binary_path;
+
+    /** The flag that is @p true if the program that is being linked was loaded from its cached binary. */
+    bool loaded_from_binary = false;
+
+    /** The directory with the cached program binaries, the cache is disabled if it is empty. */
+    static std::filesystem::path binary_cache_directory;
+
     // ----------------------------------------------------------------------------
     // Constructors
     // ----------------------------------------------------------------------------
@@ -67,9 +79,7 @@ public:
     ShaderProgram(const std::filesystem::path& vertex_shader, const std::filesystem::path& fragment_shader);
 
     ShaderProgram(const ShaderProgram& other)
-        : shaders(other.shaders) {
-        program = glCreateProgram();
-
+        : ShaderProgram() {
         for (const Shader& shader : other.shaders) {
             add_shader(shader.shader_type, shader.file_path);
         }
@@ -94,8 +104,9 @@ public:
         return *this;
     };
 
-    ShaderProgram(ShaderProgram&& other)
-        : ShaderProgram() { swap_fields(*this, other); };
+    // The moved-to program starts without an OpenGL object so that the moved-from one does not own a new one.
+    ShaderProgram(ShaderProgram&& other) noexcept
+        : program(0), valid(false) { swap_fields(*this, other); };
 
     friend void swap_fields(ShaderProgram& first, ShaderProgram& second) noexcept {
         using std::swap;
@@ -103,6 +114,8 @@ public:
         swap(first.shaders, second.shaders);
         swap(first.program, second.program);
         swap(first.valid, second.valid);
+        swap(first.binary_path, second.binary_path);
+        swap(first.loaded_from_binary, second.loaded_from_binary);
     }
 
     /** Destructor that automatically destroys the OpenGL object. */
@@ -116,23 +129,92 @@ public:
      * Links the program and checks for errors. When this fails, the errors are printed to stdout and the
      * program is destroyed.
      *
-     * Returns true if everything is OK, false if something failed.
+     * The shaders are compiled here. If the binary cache is enabled, the program binary of the same sources linked by
+     * the same driver is loaded instead, and the newly linked programs are added to the cache. The binaries rejected
+     * by the driver are removed from the cache and the shaders are compiled as usual.
+     *
+     * Returns true if everything is OK, false if something failed. The method waits for the link, it is equivalent to
+     * @link begin_link followed by @link finish_link.
      *
      * @return	True if it succeeds, false if it fails.
      */
     bool link();
 
+    /**
+     * Starts compiling the shaders and linking the program without waiting for the results, or loads the program
+     * from its cached binary. With GL_KHR_parallel_shader_compile, the driver compiles and links in the background,
+     * hence many programs can be started first and then finished together.
+     */
+    void begin_link();
+
+    /**
+     * Checks if the link started by @link begin_link has finished, i.e., if @link finish_link will not wait. Without
+     * GL_KHR_parallel_shader_compile, the driver compiles in @link begin_link and the link is always finished.
+     *
+     * @return	{@p true} if the link has finished, {@p false} if it is still in progress.
+     */
+    bool is_link_finished() const;
+
+    /**
+     * Waits for the link started by @link begin_link, prints the errors of the compilation and the link to stdout, and
+     * stores the binary of the linked program into the cache.
+     *
+     * @return	True if it succeeds, false if it fails.
+     */
+    bool finish_link();
+
     /** Checks if the program is ready and if yes then it calls glUseProgram with this program as the parameter. */
     void use() const;
 
     /** Deletes the program. */
     void delete_program();
 
+    /**
+     * Sets the directory with the cached program binaries used by all programs linked afterwards. The directory is
+     * created when the first binary is stored.
+     *
+     * @param 	directory	The directory, an empty path disables the cache.
+     */
+    static void set_binary_cache_directory(const std::filesystem::path& directory);
+
+    /**
+     * Checks if the driver supports GL_KHR_parallel_shader_compile.
+     *
+     * @return	{@p true} if the shaders are compiled in the background, {@p false} if they are compiled in place.
+     */
+    static bool is_parallel_compile_supported();
+
+protected:
+    /**
+     * Returns the path to the cached binary of this program. Its name is a hash of the driver, and of the types and
+     * the expanded sources of the shaders (with their includes), hence any change of them gives a new binary.
+     *
+     * @return	The path to the binary, or an empty path if the cache is disabled.
+     */
+    std::filesystem::path get_binary_cache_path() const;
+
+    /**
+     * Loads the program from the cached binary.
+     *
+     * @param 	path	The path to the binary.
+     * @return	{@p true} if the program is linked from the binary, {@p false} if there is none or the driver rejected it.
+     */
+    bool load_binary(const std::filesystem::path& path);
+
+    /**
+     * Stores the binary of the linked program into the cache.
+     *
+     * @param 	path	The path to the binary.
+     */
+    void save_binary(const std::filesystem::path& path) const;
+
+public:
+
     // ----------------------------------------------------------------------------
     // Add Methods
     // ----------------------------------------------------------------------------
     /**
-     * Adds a specified shader. Note that if the compilation fails, the program is automatically destroyed.
+     * Adds a specified shader and loads its source code, the shader is compiled by @link link.
      *
      * Example of use: my_program.add_shader(GL_VERTEX_SHADER, "my_shader.vert");
      *
@@ -25,6 +25,9 @@ public:
     /** The path to the source code file. */
     std::filesystem::path file_path = {};
 
+    /** The source code with all includes expanded (see @link ShaderUtils::load_shader). */
+    std::string source = {};
+
     // ----------------------------------------------------------------------------
     // Constructors
     // ----------------------------------------------------------------------------
@@ -32,8 +35,8 @@ public:
     }
 
     /**
-     * Creates a shader of given type, loads and sets its source code, compiles it, and prints errors to
-     * stdout if some occur. Note that the @link shader attribute is set to 0 if the compilation fails.
+     * Creates a shader of given type and loads its source code. The shader is compiled only by @link begin_compile,
+     * i.e., not at all if its program is loaded from a program binary (see @link ShaderProgram::begin_link).
      *
      * @param 	shader_type	Type of the shader.
      * @param 	file_path  	File path to the file.
@@ -54,7 +57,7 @@ public:
     */
     Shader& operator=(Shader other);
 
-    Shader(Shader&& other);
+    Shader(Shader&& other) noexcept;
 
     friend void swap_fields(Shader& first, Shader& second) noexcept {
         using std::swap;
@@ -62,7 +65,25 @@ public:
         swap(first.shader, second.shader);
         swap(first.shader_type, second.shader_type);
         swap(first.file_path, second.file_path);
+        swap(first.source, second.source);
     }
 
     virtual ~Shader();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+    /**
+     * Creates the OpenGL shader object, sets the loaded source code, and starts compiling it. The driver may compile
+     * the shader in the background (see GL_KHR_parallel_shader_compile), hence the result is not checked here.
+     */
+    void begin_compile();
+
+    /**
+     * Waits until the compilation finishes and prints errors to stdout if some occur. Note that the @link shader
+     * attribute is set to 0 if the compilation fails.
+     *
+     * @return	{@p true} if the shader is compiled, {@p false} if it failed.
+     */
+    bool finish_compile();
 };
@@ -113,7 +113,7 @@ public:
      *
      * @param 	other	The other buffer that will be moved.
      */
-    UBO(UBO&& other) noexcept : UBO(0, true /* We do not need to initialize OpenGL while moving */) { swap_fields(*this, other); }
+    UBO(UBO&& other) noexcept : UBO(0, GL_UNIFORM_BUFFER, true /* We do not need to initialize OpenGL while moving */) { swap_fields(*this, other); }
 
     /**
      * The copy assignment operator using copy-and-swap idiom.
@@ -131,7 +131,9 @@ public:
      * Destroys this @link UBO. Note that the OpenGL counterpart is also destroyed.
      */
     virtual ~UBO() {
-        glDeleteBuffers(1, &opengl_object);
+        if (!cpu_only) {
+            glDeleteBuffers(1, &opengl_object);
+        }
     }
 
     // ----------------------------------------------------------------------------
@@ -174,5 +176,8 @@ public:
     // ----------------------------------------------------------------------------
 public:
     /** Returns the data currently stored in this buffer. */
-    const std::vector<T>& get_data() { return this->data; }
+    const std::vector<T>& get_data() const { return this->data; }
+
+    /** Returns the data stored in this buffer for modification, the changes are copied to GPU by @link update_opengl_data. */
+    std::vector<T>& get_data() { return this->data; }
 };
@@ -50,4 +50,7 @@ public:
     std::filesystem::path get_path(const std::string& key, std::string fallback = "") {
         return toml::find_or<std::string>(configuration, key, fallback);
     }
+
+    /** Returns the application runtime directory. */
+    const std::filesystem::path& get_runtime_directory() const { return runtime_directory; }
 };
\ No newline at end of file
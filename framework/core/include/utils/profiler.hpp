@@ -0,0 +1,180 @@
+#pragma once
+
+#include "gpu_timer.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+/**
+ * The process-wide profiler collecting CPU scopes (from any thread) and GPU passes measured by a @link GPUTimer. The
+ * collected events can be saved in the Trace Event Format that is understood by chrome://tracing and Perfetto
+ * (https://ui.perfetto.dev).
+ *
+ * The events are collected only while the recording is enabled and only the last @link max_events events are kept,
+ * so the recording can stay enabled under a long-running load and the trace can be saved when something interesting
+ * happens.
+ */
+class Profiler {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  public:
+    /** The maximum number of kept events, the oldest events are discarded. */
+    static const size_t max_events = 1 << 20;
+
+    /** The thread identifier under which the GPU passes are stored. */
+    static const int gpu_thread = 0;
+
+  protected:
+    /** A completed event (a scope or a pass). */
+    struct Event {
+        /** The name of the event, it is either a string literal or an interned copy (see @link intern). */
+        const char* name;
+        /** The thread identifier (@link gpu_thread for GPU passes). */
+        int thread;
+        /** The start of the event since the profiler was created (in microseconds). */
+        double start;
+        /** The duration of the event (in microseconds). */
+        double duration;
+    };
+
+    /** The flag determining if the events are recorded. */
+    std::atomic<bool> enabled = false;
+
+    /** The time when the profiler was created, all events are relative to it. */
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    /** The difference between the CPU time (relative to @link epoch) and the GPU timestamps (in microseconds). */
+    double gpu_offset = 0.0;
+
+    /** The flag determining if @link gpu_offset was measured for the current recording. */
+    bool gpu_offset_valid = false;
+
+    /** The recorded events. */
+    std::deque<Event> events;
+
+    /** The distinct names of the GPU passes (the set is node-based, hence the addresses of the names are stable). */
+    std::unordered_set<std::string> names;
+
+    /** The mutex protecting @link events and @link names. */
+    std::mutex mutex;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  protected:
+    Profiler() = default;
+
+  public:
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /** Returns the profiler instance. */
+    static Profiler& get();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /** Returns the current time since the profiler was created (in microseconds). */
+    double now() const { return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count(); }
+
+    /**
+     * Records a CPU event of the calling thread.
+     *
+     * @param 	name 	The name of the event, it must outlive the profiler (e.g., a string literal).
+     * @param 	start	The start of the event returned by @link now.
+     * @param 	end  	The end of the event returned by @link now.
+     */
+    void add_cpu_event(const char* name, double start, double end);
+
+    /**
+     * Records the passes of the last frame read back by the timer. Call it after @link GPUTimer::begin_frame returns
+     * @p true. It requires a current OpenGL context (the GPU clock is synchronized with the CPU one on first use).
+     *
+     * @param 	timer	The timer.
+     */
+    void add_gpu_frame(const GPUTimer& timer);
+
+    /** Removes all recorded events. */
+    void clear();
+
+    /**
+     * Saves the recorded events as a JSON trace.
+     *
+     * @param 	file_path	The path to the file.
+     * @return	@p true if the file was written, @p false otherwise.
+     */
+    bool save(const std::filesystem::path& file_path);
+
+  protected:
+    /** Stores the event and discards the oldest one if there are too many; the mutex must be locked. */
+    void push_event(const Event& event);
+
+    /** Returns a stable copy of the name; the mutex must be locked. */
+    const char* intern(const std::string& name);
+
+    /** Returns a small identifier of the calling thread (starting from 1). */
+    static int get_thread_id();
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+  public:
+    /** Checks if the events are recorded. */
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /** Enables or disables the recording; the GPU clock is synchronized again when it is enabled. */
+    void set_enabled(bool enabled);
+
+    /** Returns the number of recorded events. */
+    size_t get_event_count();
+};
+
+/**
+ * The scope measuring the CPU time from its construction to its destruction, and optionally also the GPU time of the
+ * commands issued in between as a pass of the specified @link GPUTimer. The scopes may be nested.
+ *
+ * Usage:
+ * <code>
+ *  void Application::render_snow() {
+ *      ProfileScope scope("render_snow", &gpu_timer);
+ *      ...
+ *  }
+ * </code>
+ */
+class ProfileScope {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+  protected:
+    /** The name of the scope. */
+    const char* name;
+    /** The timer measuring the GPU pass or @p nullptr. */
+    GPUTimer* gpu_timer;
+    /** The start of the scope or a negative value if the profiler is disabled. */
+    double start;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Begins the scope.
+     *
+     * @param 	name	 	The name of the scope, it must outlive the profiler (e.g., a string literal).
+     * @param 	gpu_timer	The timer measuring the GPU pass or @p nullptr if only the CPU time should be measured.
+     * 						The GPU pass is measured even if the profiler is disabled (the timer is always running).
+     */
+    explicit ProfileScope(const char* name, GPUTimer* gpu_timer = nullptr);
+
+    /** Ends the scope. */
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
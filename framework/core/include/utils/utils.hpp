@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <cstring> // <cstring> instead of string as workaround for unix-based systems
 
 /**
@@ -65,20 +66,33 @@ class ShaderUtils {
      * @return	The loaded string.
      */
     static std::string load_shader(const std::filesystem::path& input_path, std::string include_indentifier = "#pragma include") {
+        include_indentifier += ' ';
+
+        // The included files are appended into one stream; the recursion does not rely on any static state so that
+        // the loader can be called repeatedly (and from several threads) with the same result.
+        std::ostringstream full_source_code;
+        load_shader(input_path, include_indentifier, full_source_code);
+        return full_source_code.str();
+    }
+
+  private:
+    /**
+     * Recursively appends the source code of the shader and of its includes into the stream.
+     *
+     * @param 	input_path		   	The path to the shader file.
+     * @param 	include_indentifier	The include indentifier followed by a space.
+     * @param 	full_source_code   	The stream with the loaded source code.
+     */
+    static void load_shader(const std::filesystem::path& input_path, const std::string& include_indentifier, std::ostringstream& full_source_code) {
         std::filesystem::path path = input_path;
         path.make_preferred();
         std::filesystem::path directory = path;
         directory.remove_filename();
 
-        include_indentifier += ' ';
-        static bool is_recursive_call = false;
-
-        std::string full_source_code = "";
         std::ifstream file(path);
-
         if (!file.is_open()) {
             std::cerr << "ERROR: could not open the shader at: " << path << "\n" << std::endl;
-            return full_source_code;
+            return;
         }
 
         std::string line_buffer;
@@ -88,30 +102,17 @@ class ShaderUtils {
                 // Removes the include identifier, this will cause the path to remain.
                 line_buffer.erase(0, include_indentifier.size());
 
-                // The include path is relative to the current shader file path.
-                const std::filesystem::path include_path = directory / line_buffer;
-
-                // By using recursion, the new include file can be extracted
-                // and inserted at this location in the shader source code.
-                is_recursive_call = true;
-                full_source_code += load_shader(include_path);
+                // The include path is relative to the current shader file path. By using recursion, the new include file
+                // can be extracted and inserted at this location in the shader source code.
+                load_shader(directory / line_buffer, include_indentifier, full_source_code);
 
                 // Do not add this line to the shader source code, as the include
                 // path would generate a compilation issue in the final source code.
                 continue;
             }
 
-            full_source_code += line_buffer + '\n';
+            full_source_code << line_buffer << '\n';
         }
-
-        // Only add the null terminator at the end of the complete file,
-        // essentially skipping recursive function calls this way.
-        if (!is_recursive_call)
-            full_source_code += '\0';
-
-        file.close();
-
-        return full_source_code;
     }
 };
 
@@ -234,4 +235,38 @@ class TextureUtils {
         const std::filesystem::path filename_ny,
         const std::filesystem::path filename_pz,
         const std::filesystem::path filename_nz);
+
+    /**
+     * Saves the RGBA pixels as an image. The format is determined by the extension: '.hdr' stores the floating point
+     * values as a Radiance HDR image, any other extension stores them clamped to [0, 1] as a PNG image.
+     *
+     * @param 	filename	The filename of the image.
+     * @param 	width   	The width of the image.
+     * @param 	height  	The height of the image.
+     * @param 	pixels  	The RGBA pixels with the bottom row first (as returned by glReadPixels).
+     * @return	@p true if the image was saved, @p false otherwise.
+     */
+    static bool save_image(const std::filesystem::path filename, int width, int height, const float* pixels);
+};
+
+/**
+ * The class providing a collection of static utility methods for the benchmarks.
+ */
+class BenchmarkUtils {
+
+  public:
+    /**
+     * Forces the compiler to compute the value, i.e., it prevents removing the measured work whose result is otherwise unused.
+     *
+     * @param 	value	The result of the measured work.
+     */
+    template <typename T> static void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        // An empty assembly that reads the value (from a register or memory) and may touch any memory.
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        // A volatile read of the value cannot be removed by the compiler.
+        static_cast<void>(*reinterpret_cast<const volatile char*>(&value));
+#endif
+    }
 };
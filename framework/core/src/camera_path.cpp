@@ -0,0 +1,57 @@
+#include "camera_path.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+CameraPath CameraPath::from_file(const std::filesystem::path& file_path) {
+    CameraPath path;
+    std::ifstream file(file_path);
+    if (!file) {
+        std::cerr << "Could not open the camera path " << file_path.generic_string() << "." << std::endl;
+        return path;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        float time, direction, elevation, distance;
+        if (line.empty() || line[0] == '#' || !(stream >> time >> direction >> elevation >> distance)) {
+            continue;
+        }
+        path.add_keyframe(time, glm::radians(direction), glm::radians(elevation), distance);
+    }
+    return path;
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void CameraPath::add_keyframe(float time, float angle_direction, float angle_elevation, float distance) {
+    const Keyframe keyframe{time, angle_direction, angle_elevation, distance};
+    const auto position = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& k) { return t < k.time; });
+    keyframes.insert(position, keyframe);
+}
+
+void CameraPath::apply(float time, Camera& camera) const {
+    if (keyframes.empty()) {
+        return;
+    }
+
+    // Finds the first keyframe after the time and interpolates it with the previous one.
+    const auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& k) { return t < k.time; });
+    if (next == keyframes.begin() || next == keyframes.end()) {
+        const Keyframe& k = next == keyframes.begin() ? keyframes.front() : keyframes.back();
+        camera.set_eye_position(k.angle_direction, k.angle_elevation, k.distance);
+        return;
+    }
+
+    const Keyframe& a = *(next - 1);
+    const Keyframe& b = *next;
+    const float t = (time - a.time) / (b.time - a.time);
+    camera.set_eye_position(glm::mix(a.angle_direction, b.angle_direction, t), glm::mix(a.angle_elevation, b.angle_elevation, t),
+                            glm::mix(a.distance, b.distance, t));
+}
@@ -1,16 +1,15 @@
 #pragma once
 
 #include "default_application.hpp"
+#include "utils/profiler.hpp"
 
 DefaultApplication::DefaultApplication(int initial_width, int initial_height, std::vector<std::string> arguments) : IApplication(initial_width, initial_height, arguments) {
     DefaultApplication::compile_shaders();
+    update_pending_programs(true);
 
     // Creates the empty VAO.
     glGenVertexArrays(1, &empty_vao);
 
-    // Creates the query object.
-    glCreateQueries(GL_TIME_ELAPSED, 1, &render_time_query);
-
     // Initializes the materials.
     red_material_ubo.set_material(PhongMaterialData(glm::vec3(1.0f, 0.0f, 0.0f), true, 200.0f, 1.0f));
     green_material_ubo.set_material(PhongMaterialData(glm::vec3(0.0f, 1.0f, 0.0f), true, 200.0f, 1.0f));
@@ -37,8 +36,54 @@ DefaultApplication::DefaultApplication(int initial_width, int initial_height, st
 void DefaultApplication::compile_shaders() {
     // The default shader paths assume the standard file structure.
     // TODO: replace the original shaders in the framework with the new versions from PV227.
-    default_unlit_program = ShaderProgram(framework_shaders_path / "object.vert", framework_shaders_path / "unlit.frag");
-    default_lit_program = ShaderProgram(framework_shaders_path / "object.vert", framework_shaders_path / "lit.frag");
+    reload_program(default_unlit_program, framework_shaders_path / "object.vert", framework_shaders_path / "unlit.frag");
+    reload_program(default_lit_program, framework_shaders_path / "object.vert", framework_shaders_path / "lit.frag");
+}
+
+void DefaultApplication::reload_program(ShaderProgram& target, ShaderProgram&& new_program) {
+    new_program.begin_link();
+    pending_programs.emplace_back(&target, std::move(new_program));
+}
+
+void DefaultApplication::reload_program(ShaderProgram& target, const std::filesystem::path& vertex_shader, const std::filesystem::path& fragment_shader) {
+    ShaderProgram new_program;
+    new_program.add_vertex_shader(vertex_shader);
+    new_program.add_fragment_shader(fragment_shader);
+    reload_program(target, std::move(new_program));
+}
+
+void DefaultApplication::reload_compute_program(ShaderProgram& target, const std::filesystem::path& compute_shader) {
+    ShaderProgram new_program;
+    new_program.add_compute_shader(compute_shader);
+    reload_program(target, std::move(new_program));
+}
+
+void DefaultApplication::update_pending_programs(bool wait) {
+    if (pending_programs.empty()) {
+        return;
+    }
+    // All programs are replaced at once so that the frame never mixes the old and the new shaders.
+    if (!wait) {
+        for (const auto& [target, new_program] : pending_programs) {
+            if (!new_program.is_link_finished()) {
+                return;
+            }
+        }
+    }
+
+    bool valid = true;
+    for (auto& [target, new_program] : pending_programs) {
+        valid &= new_program.finish_link();
+    }
+    if (valid || wait) {
+        for (auto& [target, new_program] : pending_programs) {
+            *target = std::move(new_program);
+        }
+        std::cout << "Shaders are reloaded." << std::endl;
+    } else {
+        std::cout << "Shaders are not reloaded, the previous programs are kept." << std::endl;
+    }
+    pending_programs.clear();
 }
 
 void DefaultApplication::update(float delta) {
@@ -48,6 +93,23 @@ void DefaultApplication::update(float delta) {
     fps_cpu = 1000 / delta;
 }
 
+void DefaultApplication::begin_frame() {
+    // Replaces the programs reloaded in the background once they are ready.
+    update_pending_programs(false);
+
+    if (gpu_timer.begin_frame()) {
+        Profiler::get().add_gpu_frame(gpu_timer);
+    }
+    // Computes FPS from the last frame measured on GPU (it is a few frames old).
+    if (gpu_timer.get_frame_time() > 0.0f) {
+        fps_gpu = 1000.0f / gpu_timer.get_frame_time();
+    }
+}
+
+void DefaultApplication::end_frame() {
+    gpu_timer.end_frame();
+}
+
 void DefaultApplication::render() {
     glClearColor(0, 0, 0, 1);
     glClear(GL_COLOR_BUFFER_BIT);
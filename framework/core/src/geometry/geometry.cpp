@@ -37,13 +37,13 @@ Geometry::Geometry(GLenum mode, int elements_per_vertex, std::vector<float> inte
 
 Geometry::Geometry(
     GLenum mode,
-    std::vector<float> positions,
-    std::vector<uint32_t> indices,
-    std::vector<float> normals,
-    std::vector<float> colors,
-    std::vector<float> tex_coords,
-    std::vector<float> tangents,
-    std::vector<float> bitangents,
+    const std::vector<float>& positions,
+    const std::vector<uint32_t>& indices,
+    const std::vector<float>& normals,
+    const std::vector<float>& colors,
+    const std::vector<float>& tex_coords,
+    const std::vector<float>& tangents,
+    const std::vector<float>& bitangents,
     GLint position_loc,
     GLint normal_loc,
     GLint tex_coord_loc,
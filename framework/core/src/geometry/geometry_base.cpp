@@ -17,8 +17,8 @@ Geometry_Base::Geometry_Base(GLenum mode, int elements_per_vertex, int vertices_
     draw_arrays_count = vertices_count;
 }
 
-Geometry_Base::Geometry_Base(GLenum mode, std::vector<float> positions, std::vector<uint32_t> indices, std::vector<float> normals, std::vector<float> colors, std::vector<float> tex_coords,
-                             std::vector<float> tangents, std::vector<float> bitangents, GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc,
+Geometry_Base::Geometry_Base(GLenum mode, const std::vector<float>& positions, const std::vector<uint32_t>& indices, const std::vector<float>& normals, const std::vector<float>& colors,
+                             const std::vector<float>& tex_coords, const std::vector<float>& tangents, const std::vector<float>& bitangents, GLint position_loc, GLint normal_loc, GLint tex_coord_loc, GLint tangent_loc, GLint bitangent_loc,
                              GLint color_loc)
     : mode(mode), position_loc(!positions.empty() ? position_loc : -1), normal_loc(!normals.empty() ? normal_loc : -1),
       tex_coord_loc(!tex_coords.empty() ? tex_coord_loc : -1), tangent_loc(!tangents.empty() ? tangent_loc : -1),
@@ -31,7 +31,8 @@ Geometry_Base::Geometry_Base(GLenum mode, std::vector<float> positions, std::vec
     // Computes the number of vertices.
     const int vertices_count = static_cast<int>(positions.size() / 3);
 
-    // Builds the interleaved buffer from the input data.
+    // Builds the interleaved buffer from the input data (allocated once, the buffer size is known in advance).
+    interleaved_vertices.reserve(static_cast<size_t>(vertices_count) * elements_per_vertex);
     for (size_t i = 0; i < positions.size() / 3; i += 1) {
         interleaved_vertices.push_back(positions[i * 3 + 0]);
         interleaved_vertices.push_back(positions[i * 3 + 1]);
@@ -11,6 +11,10 @@ IApplication::IApplication(int initial_width, int initial_height, std::vector<st
     shaders_path = configuration.get_path("shaders", "/shaders");
     textures_path = configuration.get_path("textures", "/textures");
     framework_textures_path = configuration.get_path("framework_textures", "/textures");
+
+    // The program binaries are cached next to the binary unless the configuration sets another directory (an empty
+    // string disables the cache).
+    ShaderProgram::set_binary_cache_directory(configuration.get_path("shader_cache", (configuration.get_runtime_directory() / "shader_cache").string()));
 }
 
 // ----------------------------------------------------------------------------
@@ -105,3 +109,9 @@ size_t IApplication::get_height() const { return this->height; }
 std::filesystem::path IApplication::get_framework_shaders_path() const { return this->framework_shaders_path; }
 
 void IApplication::set_window(GLFWwindow* window) { this->window = window; }
+
+Camera& IApplication::get_camera() { return this->camera; }
+
+GLuint IApplication::get_output_framebuffer() const { return this->output_framebuffer; }
+
+void IApplication::set_output_framebuffer(GLuint framebuffer) { this->output_framebuffer = framebuffer; }
@@ -1,10 +1,51 @@
 #include "manager.hpp"
 #include "GLFW/glfw3.h"
+#include "camera_path.hpp"
 #include "glad/glad.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "utils/profiler.hpp"
+#include "utils/utils.hpp"
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <ostream>
+#include <sstream>
+
+namespace {
+/** Returns the path of the image of the specified frame (the frame number is appended only if there are more frames). */
+std::filesystem::path get_frame_path(const OfflineSettings& settings, int frame) {
+    if (settings.frames == 1) {
+        return settings.output;
+    }
+    std::ostringstream name;
+    name << settings.output.stem().string() << "_" << std::setw(4) << std::setfill('0') << frame << settings.output.extension().string();
+    return settings.output.parent_path() / name.str();
+}
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Offline Settings
+// ----------------------------------------------------------------------------
+OfflineSettings OfflineSettings::from_arguments(const std::vector<std::string>& arguments) {
+    OfflineSettings settings;
+    for (size_t i = 1; i < arguments.size(); i++) {
+        const std::string& argument = arguments[i];
+        const bool has_value = i + 1 < arguments.size();
+        if (argument == "--headless") {
+            settings.enabled = true;
+        } else if (argument == "--frames" && has_value) {
+            settings.frames = std::max(1, std::atoi(arguments[++i].c_str()));
+        } else if (argument == "--frame-time" && has_value) {
+            settings.frame_time = static_cast<float>(std::atof(arguments[++i].c_str()));
+        } else if (argument == "--output" && has_value) {
+            settings.output = arguments[++i];
+        } else if (argument == "--camera-path" && has_value) {
+            settings.camera_path = arguments[++i];
+        }
+    }
+    return settings;
+}
 
 // ----------------------------------------------------------------------------
 // Methods
@@ -13,6 +54,13 @@ void OpenGLManager::init(int width = 1280, int height = 720, std::string title =
     // Sets up the GLFW error messages.
     glfwSetErrorCallback(&glfw_message_callback);
 
+#ifdef GLFW_PLATFORM_NULL
+    // The null platform (GLFW 3.4) does not need any display.
+    if (headless) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     // Initializes GLFW
     if (!glfwInit()) {
         std::cerr << "Could not initialize GLFW!" << std::endl;
@@ -27,9 +75,22 @@ void OpenGLManager::init(int width = 1280, int height = 720, std::string title =
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true); // this should be ignored on GL < 4.3 (at least I think so)
     glfwWindowHint(GLFW_SAMPLES, samples_per_pixel);
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+    }
 
     // Creates the window.
     window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+#ifdef GLFW_PLATFORM_NULL
+    if (!window && headless) {
+        // Falls back to the OSMesa software rasterizer if EGL is not available.
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    }
+#endif
     if (!window) {
         std::cerr << "Could not create a window!" << std::endl;
 
@@ -75,6 +136,11 @@ void OpenGLManager::init(int width = 1280, int height = 720, std::string title =
         glDebugMessageCallback(opengl_message_callback, nullptr);
     }
 
+    // The GUI is not rendered in the headless mode.
+    if (headless) {
+        return;
+    }
+
     // Setup ImGui context.
     ImGui::CreateContext();
     ImGui::StyleColorsLight();
@@ -106,32 +172,103 @@ void OpenGLManager::run(IApplication& application) {
     ImGui::GetStyle().ScaleAllSizes(xscale);
 
     while (!glfwWindowShouldClose(window)) {
+        ProfileScope frame_scope("Frame");
+
         // Measures the elapsed time.
         const double current_time = glfwGetTime() * 1000.0; // from seconds to milliseconds
         const double elapsed_time = current_time - last_glfw_time;
         last_glfw_time = current_time;
 
         // Poll for and process events.
-        glfwPollEvents();
+        {
+            ProfileScope scope("Poll Events");
+            glfwPollEvents();
+        }
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         // Application render
+        application.begin_frame();
         application.update(static_cast<float>(elapsed_time));
-        application.render();
+        {
+            ProfileScope scope("render");
+            application.render();
+        }
         application.render_ui();
 
         // Rendering
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            ProfileScope scope("ImGui Draw");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        application.end_frame();
 
         // Swap front and back buffers
-        glfwSwapBuffers(window);
+        {
+            ProfileScope scope("Swap Buffers");
+            glfwSwapBuffers(window);
+        }
     }
 }
 
+bool OpenGLManager::run_offline(IApplication& application, const OfflineSettings& settings, const std::function<void(int)>& on_frame) {
+    application.set_window(window);
+    const int width = static_cast<int>(application.get_width());
+    const int height = static_cast<int>(application.get_height());
+
+    // Creates the frame buffer replacing the window, the colors are stored as floats so that HDR images keep the full range.
+    GLuint color_texture, depth_renderbuffer, framebuffer;
+    glCreateTextures(GL_TEXTURE_2D, 1, &color_texture);
+    glTextureStorage2D(color_texture, 1, GL_RGBA32F, width, height);
+    glCreateRenderbuffers(1, &depth_renderbuffer);
+    glNamedRenderbufferStorage(depth_renderbuffer, GL_DEPTH24_STENCIL8, width, height);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, color_texture, 0);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+    glNamedFramebufferReadBuffer(framebuffer, GL_COLOR_ATTACHMENT0);
+    bool success = FBOUtils::check_framebuffer_status(framebuffer, "Offline Output");
+    application.set_output_framebuffer(framebuffer);
+
+    const CameraPath camera_path = settings.camera_path.empty() ? CameraPath() : CameraPath::from_file(settings.camera_path);
+    std::vector<float> pixels(static_cast<size_t>(width) * height * 4);
+    for (int frame = 0; success && frame < settings.frames; frame++) {
+        ProfileScope frame_scope("Frame");
+
+        // The time is fixed so that the result does not depend on the speed of the machine.
+        camera_path.apply(frame * settings.frame_time, application.get_camera());
+        application.begin_frame();
+        application.update(settings.frame_time);
+        application.render();
+        application.end_frame();
+        if (on_frame) {
+            on_frame(frame);
+        }
+        if (settings.output.empty()) {
+            continue;
+        }
+
+        ProfileScope scope("Save Image");
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+
+        const std::filesystem::path frame_path = get_frame_path(settings, frame);
+        if (!TextureUtils::save_image(frame_path, width, height, pixels.data())) {
+            std::cerr << "Could not save the image " << frame_path.generic_string() << "!" << std::endl;
+            success = false;
+        }
+    }
+
+    application.set_output_framebuffer(0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depth_renderbuffer);
+    glDeleteTextures(1, &color_texture);
+    return success;
+}
+
 void OpenGLManager::print_info() const {
     std::cout << "----------------------------------------------" << std::endl;
     std::cout << "OpenGL: " << glGetString(GL_VERSION) << std::endl;
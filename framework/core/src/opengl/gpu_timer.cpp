@@ -0,0 +1,96 @@
+#include "gpu_timer.hpp"
+#include <algorithm>
+#include <cassert>
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+GPUTimer::GPUTimer(int latency) : frames(std::max(1, latency) + 1) {}
+
+GPUTimer::~GPUTimer() {
+    for (Frame& frame : frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+bool GPUTimer::begin_frame() {
+    current = (current + 1) % static_cast<int>(frames.size());
+    Frame& frame = frames[current];
+    const bool resolved = frame.pending;
+    if (resolved) {
+        resolve(frame);
+    }
+
+    frame.used = 0;
+    frame.passes.clear();
+    open_passes.clear();
+    record_timestamp();
+    return resolved;
+}
+
+void GPUTimer::end_frame() {
+    const int end = record_timestamp();
+    for (const int pass : open_passes) {
+        frames[current].passes[pass].end = end;
+    }
+    open_passes.clear();
+    frames[current].pending = true;
+}
+
+void GPUTimer::begin_pass(const std::string& name) {
+    Frame& frame = frames[current];
+    frame.passes.push_back(Pass{name, record_timestamp(), -1});
+    open_passes.push_back(static_cast<int>(frame.passes.size()) - 1);
+}
+
+void GPUTimer::end_pass() {
+    assert(!open_passes.empty() && "There is no GPU pass to end.");
+    frames[current].passes[open_passes.back()].end = record_timestamp();
+    open_passes.pop_back();
+}
+
+std::vector<GPUPassTime> GPUTimer::get_total_pass_times() const {
+    std::vector<GPUPassTime> total_times;
+    for (const GPUPassTime& pass : pass_times) {
+        const auto total = std::find_if(total_times.begin(), total_times.end(), [&](const GPUPassTime& t) { return t.name == pass.name; });
+        if (total == total_times.end()) {
+            total_times.push_back(pass);
+        } else {
+            total->time += pass.time;
+        }
+    }
+    return total_times;
+}
+
+int GPUTimer::record_timestamp() {
+    Frame& frame = frames[current];
+    if (frame.used == static_cast<int>(frame.queries.size())) {
+        GLuint query;
+        glCreateQueries(GL_TIMESTAMP, 1, &query);
+        frame.queries.push_back(query);
+    }
+    glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+    return frame.used++;
+}
+
+void GPUTimer::resolve(Frame& frame) {
+    // The frame was recorded several frames ago, hence the results are usually available and nothing waits here.
+    std::vector<GLuint64> timestamps(frame.used);
+    for (int i = 0; i < frame.used; i++) {
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+    frame.pending = false;
+
+    const auto to_milliseconds = [&](int begin, int end) { return static_cast<float>(timestamps[end] - timestamps[begin]) * 1e-6f; };
+    frame_timestamp = timestamps[0];
+    frame_time = to_milliseconds(0, frame.used - 1);
+    pass_times.clear();
+    for (const Pass& pass : frame.passes) {
+        pass_times.push_back(GPUPassTime{pass.name, to_milliseconds(0, pass.begin), to_milliseconds(pass.begin, pass.end)});
+    }
+}
@@ -1,10 +1,42 @@
 #include "program.hpp"
+#include "utils/utils.hpp"
 
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 
+namespace {
+/** Adds the string into the 64-bit FNV-1a hash. */
+uint64_t hash_string(uint64_t hash, std::string_view string) {
+    for (const char c : string) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Returns the string identifying the driver, the binaries of one driver are usually rejected by the others. */
+std::string get_driver_string() {
+    std::string driver;
+    for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+        const GLubyte* value = glGetString(name);
+        driver.append(value ? reinterpret_cast<const char*>(value) : "").append("\n");
+    }
+    return driver;
+}
+} // namespace
+
+std::filesystem::path ShaderProgram::binary_cache_directory = {};
+
+// The query of GL_KHR_parallel_shader_compile (the loader may be generated without the extension).
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 // ----------------------------------------------------------------------------
 // Constructors
 // ----------------------------------------------------------------------------
@@ -23,13 +55,60 @@ ShaderProgram::~ShaderProgram() { delete_program(); }
 // Methods
 // ----------------------------------------------------------------------------
 bool ShaderProgram::link() {
+    begin_link();
+    return finish_link();
+}
+
+void ShaderProgram::begin_link() {
     if (!program) {
         std::cerr << "The OpenGL program object is invalid (link)." << std::endl;
-        return false;
+        return;
+    }
+
+    // Loads the program binary linked in one of the previous runs, the shaders need not be compiled then.
+    binary_path = get_binary_cache_path();
+    loaded_from_binary = !binary_path.empty() && load_binary(binary_path);
+    if (loaded_from_binary) {
+        return;
+    }
+
+    // Starts compiling the shaders, the link waits for them and the shaders that fail make the link fail.
+    for (Shader& shader : shaders) {
+        if (!shader.shader) {
+            shader.begin_compile();
+            if (shader.shader) {
+                glAttachShader(program, shader.shader);
+            }
+        }
     }
 
     // link program
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, binary_path.empty() ? GL_FALSE : GL_TRUE);
     glLinkProgram(program);
+}
+
+bool ShaderProgram::is_link_finished() const {
+    if (!program || loaded_from_binary || !is_parallel_compile_supported()) {
+        return true;
+    }
+    GLint completion_status = GL_TRUE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completion_status);
+    return completion_status == GL_TRUE;
+}
+
+bool ShaderProgram::finish_link() {
+    if (!program) {
+        return false;
+    }
+    if (loaded_from_binary) {
+        valid = true;
+        return true;
+    }
+
+    // Prints the errors of the shaders.
+    for (Shader& shader : shaders) {
+        shader.finish_compile();
+    }
 
     // link and get errors
     int link_status;
@@ -49,6 +128,9 @@ bool ShaderProgram::link() {
         return false;
     } else {
         valid = true;
+        if (!binary_path.empty()) {
+            save_binary(binary_path);
+        }
         return true;
     }
 }
@@ -62,10 +144,89 @@ void ShaderProgram::use() const {
 }
 
 void ShaderProgram::delete_program() {
-    if (is_valid()) {
-        valid = false;
+    // The program is deleted even if it failed to link.
+    valid = false;
+    if (program) {
         glDeleteProgram(program);
+        program = 0;
+    }
+}
+
+void ShaderProgram::set_binary_cache_directory(const std::filesystem::path& directory) { binary_cache_directory = directory; }
+
+bool ShaderProgram::is_parallel_compile_supported() {
+    // The extension is checked only once (the application uses a single context). The number of compiler threads is
+    // left at its initial value, which lets the driver choose it.
+    static const bool supported = Utils::is_open_gl_extension_present("GL_KHR_parallel_shader_compile");
+    return supported;
+}
+
+std::filesystem::path ShaderProgram::get_binary_cache_path() const {
+    if (binary_cache_directory.empty() || shaders.empty()) {
+        return {};
+    }
+
+    // The driver string is part of the key so that the binaries of different drivers (or their versions) do not clash.
+    uint64_t hash = hash_string(14695981039346656037ull, get_driver_string());
+    for (const Shader& shader : shaders) {
+        hash = hash_string(hash, std::to_string(shader.shader_type) + "\n");
+        hash = hash_string(hash, shader.source);
     }
+
+    std::ostringstream name;
+    name << std::hex << hash << ".bin";
+    return binary_cache_directory / name.str();
+}
+
+bool ShaderProgram::load_binary(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    GLenum format = 0;
+    if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+        return false;
+    }
+    const std::vector<char> binary{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    file.close();
+
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    int link_status;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    if (GL_FALSE == link_status) {
+        // The driver rejects the binaries of its other versions (and the corrupted files) without any error, the
+        // program can still be linked from the shaders. The binary is replaced by the new one after the link.
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    return true;
+}
+
+void ShaderProgram::save_binary(const std::filesystem::path& path) const {
+    // Drivers without any binary formats return no binary.
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    GLenum format = 0;
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    // The binary is written into a temporary file first so that other instances of the application never read an
+    // incomplete binary.
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            std::cerr << "The program binary could not be stored into " << temporary_path << "." << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
 }
 
 // ----------------------------------------------------------------------------
@@ -77,15 +238,9 @@ bool ShaderProgram::add_shader(GLenum shader_type, const std::filesystem::path&
         return false;
     }
 
-    // Loads and compiles the shader.
-    Shader& shader = shaders.emplace_back(shader_type, file_name);
-
-    if (shader.shader) {
-        glAttachShader(program, shader.shader);
-        return true;
-    } else {
-        return false;
-    }
+    // Loads the shader, it is compiled (or loaded from the program binary) in link.
+    const Shader& shader = shaders.emplace_back(shader_type, file_name);
+    return !shader.source.empty();
 }
 
 bool ShaderProgram::add_vertex_shader(const std::filesystem::path& file_name) { return add_shader(GL_VERTEX_SHADER, file_name); }
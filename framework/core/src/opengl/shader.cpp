@@ -9,19 +9,46 @@
 Shader::Shader(GLenum shader_type, const std::filesystem::path& file_path) : shader_type(shader_type), file_path(file_path) {
     // Loads the source code file from the disk.
     this->file_path.make_preferred();
-    std::string s_source = ShaderUtils::load_shader(this->file_path.generic_string());
-    if (s_source.empty()) {
+    source = ShaderUtils::load_shader(this->file_path.generic_string());
+    if (source.empty()) {
         std::cout << "File " << file_path << " is empty or failed to load" << std::endl;
+    }
+}
+
+Shader::Shader(const Shader& other) : Shader(other.shader_type, other.file_path) {}
+
+Shader& Shader::operator=(Shader other) {
+    swap_fields(*this, other);
+
+    return *this;
+}
+
+Shader::Shader(Shader&& other) noexcept : Shader() { swap_fields(*this, other); }
+
+Shader::~Shader() { glDeleteShader(shader); }
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void Shader::begin_compile() {
+    if (source.empty()) {
         return;
     }
 
     // Creates a shader object, sets the source and tries to compile it.
+    glDeleteShader(shader);
     shader = glCreateShader(shader_type);
-    const char* source = s_source.c_str();
-    glShaderSource(shader, 1, &source, nullptr);
+    const char* source_data = source.c_str();
+    glShaderSource(shader, 1, &source_data, nullptr);
     glCompileShader(shader);
+}
+
+bool Shader::finish_compile() {
+    if (!shader) {
+        return false;
+    }
 
-    // Checks the compilation status.
+    // Checks the compilation status (it waits for the compilation).
     int compile_status;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
 
@@ -59,17 +86,7 @@ Shader::Shader(GLenum shader_type, const std::filesystem::path& file_path) : sha
 
         glDeleteShader(shader);
         shader = 0;
+        return false;
     }
-}
-
-Shader::Shader(const Shader& other) : Shader(other.shader_type, other.file_path) {}
-
-Shader& Shader::operator=(Shader other) {
-    swap_fields(*this, other);
-
-    return *this;
-}
-
-Shader::Shader(Shader&& other) : Shader() { swap_fields(*this, other); }
-
-Shader::~Shader() { glDeleteShader(shader); }
\ No newline at end of file
+    return true;
+}
\ No newline at end of file
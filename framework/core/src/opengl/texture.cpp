@@ -13,8 +13,10 @@ Texture::Texture(std::filesystem::path path, bool cpu_only) : OpenGLObject(GL_TE
     int realNRChannels;
     unsigned char* data = stbi_load(path.generic_string().data(), &width, &height, &realNRChannels, 4);
 
-    if (width < 1 || height < 1) {
+    if (data == nullptr || width < 1 || height < 1) {
         std::cout << "Could not load texture: " << path << std::endl;
+        width = height = 0;
+        stbi_image_free(data);
         return;
     }
 
@@ -25,8 +27,8 @@ Texture::Texture(std::filesystem::path path, bool cpu_only) : OpenGLObject(GL_TE
 
     // Creates the CPU representation of the data.
     texture_data = std::vector<float>(width * height * nrChannels);
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
             unsigned char r = data[get_index(x, y)];
             unsigned char g = data[get_index(x, y) + 1];
             unsigned char b = data[get_index(x, y) + 2];
@@ -37,6 +39,7 @@ Texture::Texture(std::filesystem::path path, bool cpu_only) : OpenGLObject(GL_TE
             set_pixel_color(x, height - y - 1 /* we flip the y axis to have 0,0 at the bottom*/, Color(r / 255.f, g / 255.f, b / 255.f, a / 255.f));
         }
     }
+    stbi_image_free(data);
 
     // Creates the GPU representation of the data.
     if (width > 0 && height > 0 && !cpu_only) {
@@ -50,10 +53,10 @@ Texture::Texture(int width, int height, bool cpu_only) : Texture(width, height,
 
 Texture::Texture(int width, int height, GLint internal_format, GLenum format, bool cpu_only)
     : OpenGLObject(GL_TEXTURE_2D, cpu_only), width(width), height(height), internal_format(internal_format), format(format), type(GL_FLOAT) {
-    // Creates the CPU representation of the data.
+    // Creates the CPU representation of the data (the rows are contiguous in the memory).
     texture_data = std::vector<float>(width * height * nrChannels);
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
             set_pixel_color(x, y, Color::WHITE);
         }
     }
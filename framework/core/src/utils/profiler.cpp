@@ -0,0 +1,133 @@
+#include "utils/profiler.hpp"
+#include <fstream>
+#include <iomanip>
+
+namespace {
+/** Writes the string as a JSON string literal. */
+void write_json_string(std::ostream& stream, const char* string) {
+    stream << '"';
+    for (const char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            stream << '\\';
+        }
+        stream << *c;
+    }
+    stream << '"';
+}
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void Profiler::add_cpu_event(const char* name, double start, double end) {
+    const int thread = get_thread_id();
+    std::lock_guard<std::mutex> lock(mutex);
+    push_event(Event{name, thread, start, end - start});
+}
+
+void Profiler::add_gpu_frame(const GPUTimer& timer) {
+    if (!is_enabled()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!gpu_offset_valid) {
+        // The GPU timestamps use a different clock; their offset is measured once per recording.
+        GLint64 gpu_now;
+        glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+        gpu_offset = now() - static_cast<double>(gpu_now) * 1e-3;
+        gpu_offset_valid = true;
+    }
+
+    const double frame_start = static_cast<double>(timer.get_frame_timestamp()) * 1e-3 + gpu_offset;
+    push_event(Event{"GPU Frame", gpu_thread, frame_start, timer.get_frame_time() * 1e3});
+    for (const GPUPassTime& pass : timer.get_pass_times()) {
+        push_event(Event{intern(pass.name), gpu_thread, frame_start + pass.start * 1e3, pass.time * 1e3});
+    }
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+}
+
+bool Profiler::save(const std::filesystem::path& file_path) {
+    std::ofstream file(file_path);
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpu_thread << ",\"args\":{\"name\":\"GPU\"}}";
+    for (const Event& event : events) {
+        file << ",\n{\"name\":";
+        write_json_string(file, event.name);
+        file << ",\"cat\":\"" << (event.thread == gpu_thread ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+             << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+void Profiler::push_event(const Event& event) {
+    if (events.size() == max_events) {
+        events.pop_front();
+    }
+    events.push_back(event);
+}
+
+const char* Profiler::intern(const std::string& name) {
+    return names.insert(name).first->c_str();
+}
+
+int Profiler::get_thread_id() {
+    static std::atomic<int> next_id = 1;
+    thread_local const int id = next_id++;
+    return id;
+}
+
+// ----------------------------------------------------------------------------
+// Getters & Setters
+// ----------------------------------------------------------------------------
+void Profiler::set_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enabled && !is_enabled()) {
+        gpu_offset_valid = false;
+    }
+    this->enabled = enabled;
+}
+
+size_t Profiler::get_event_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events.size();
+}
+
+// ----------------------------------------------------------------------------
+// ProfileScope
+// ----------------------------------------------------------------------------
+ProfileScope::ProfileScope(const char* name, GPUTimer* gpu_timer) : name(name), gpu_timer(gpu_timer) {
+    start = Profiler::get().is_enabled() ? Profiler::get().now() : -1.0;
+    if (gpu_timer) {
+        gpu_timer->begin_pass(name);
+    }
+}
+
+ProfileScope::~ProfileScope() {
+    if (gpu_timer) {
+        gpu_timer->end_pass();
+    }
+    if (start >= 0.0) {
+        Profiler& profiler = Profiler::get();
+        profiler.add_cpu_event(name, start, profiler.now());
+    }
+}
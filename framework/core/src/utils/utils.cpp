@@ -1,6 +1,9 @@
 #include "utils/utils.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+#include <algorithm>
 #include <vector>
 
 const GLenum FBOUtils::draw_buffers_constants[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
@@ -84,3 +87,17 @@ GLuint TextureUtils::load_texture_cube(const int width, const int height, const
     glGenerateTextureMipmap(texture);
     return texture;
 }
+
+bool TextureUtils::save_image(const std::filesystem::path filename, int width, int height, const float* pixels) {
+    // OpenGL stores the bottom row first while the image formats start with the top one.
+    stbi_flip_vertically_on_write(1);
+    if (filename.extension() == ".hdr") {
+        return stbi_write_hdr(filename.generic_string().data(), width, height, 4, pixels) != 0;
+    }
+
+    std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = static_cast<unsigned char>(std::clamp(pixels[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    return stbi_write_png(filename.generic_string().data(), width, height, 4, bytes.data(), width * 4) != 0;
+}
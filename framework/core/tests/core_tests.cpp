@@ -0,0 +1,200 @@
+#include "geometry/geometry_base.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "scene/camera_ubo.hpp"
+#include "stb_image_write.h"
+#include "texture.hpp"
+#include "ubo.hpp"
+#include "utils/utils.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Regression tests of the CPU-only paths of the framework core.
+// Every test checks the result of the tested code and measures it for a problem of size N and 4N; the test fails if the
+// time grows clearly faster than linearly (e.g., because of a reallocation in a loop or a quadratic string concatenation).
+// The check does not depend on the absolute speed of the machine.
+// ----------------------------------------------------------------------------
+
+/** The maximum allowed ratio of the times for the problem of size 4N and N (a linear algorithm gives 4). */
+const double max_growth = 8.0;
+
+/** The number of measurements of every problem size, the best time is used. */
+const int repetitions = 5;
+
+/** Returns the best time (in milliseconds) of the function over the repetitions. */
+double measure(const std::function<void()>& function) {
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+/** Checks that the time of the function grows at most linearly between the problem of size N and 4N. */
+void expect_linear_growth(const std::function<void(int)>& run, int size) {
+    // Warms up the caches and the allocator before the measurement.
+    run(size);
+    const double time = measure([&] { run(size); });
+    const double time_4 = measure([&] { run(size * 4); });
+    EXPECT_LT(time_4 / std::max(time, 1e-6), max_growth) << "N " << time << " ms, 4N " << time_4 << " ms";
+}
+
+/** Writes a shader with the specified number of lines and a chain of includes, and returns the path to its main file. */
+std::filesystem::path write_shader(const std::filesystem::path& root, int lines) {
+    const std::filesystem::path directory = root / std::to_string(lines);
+    std::filesystem::create_directories(directory);
+    const int includes = 8;
+    for (int i = 0; i < includes; i++) {
+        std::ofstream include(directory / ("include_" + std::to_string(i) + ".glsl"));
+        if (i + 1 < includes) {
+            include << "#pragma include include_" << i + 1 << ".glsl\n";
+        }
+        for (int l = 0; l < lines / (2 * includes); l++) {
+            include << "float function_" << i << "_" << l << "(float x) { return x * " << l << ".0; }\n";
+        }
+    }
+
+    const std::filesystem::path main_path = directory / "main.glsl";
+    std::ofstream main(main_path);
+    main << "#version 450\n#pragma include include_0.glsl\n";
+    for (int l = 0; l < lines / 2; l++) {
+        main << "// The line " << l << " of the main shader.\n";
+    }
+    main << "void main() {}\n";
+    return main_path;
+}
+
+TEST(UBO, CpuOnlyCopyAndMove) {
+    UBO<CameraData> ubo(std::vector<CameraData>(64), 0, GL_UNIFORM_BUFFER, true);
+    UBO<CameraData> moved(std::move(ubo));
+    ASSERT_EQ(moved.get_data().size(), 64u);
+    ASSERT_LE(ubo.get_data().size(), 1u);
+
+    expect_linear_growth(
+        [](int n) {
+            UBO<CameraData> ubo(std::vector<CameraData>(n), 0, GL_UNIFORM_BUFFER, true);
+            UBO<CameraData> copy(ubo);
+            UBO<CameraData> moved(std::move(copy));
+            BenchmarkUtils::do_not_optimize(moved.get_data().size());
+        },
+        1 << 14);
+}
+
+TEST(Texture, CpuOnlyPixels) {
+    Texture texture(64, 32, true);
+    texture.set_pixel_color(63, 31, Color(0.25f, 0.5f, 0.75f, 1.0f));
+    const Color color = texture.get_pixel_color(63, 31);
+    ASSERT_EQ(texture.get_pixel_color(0, 0).r, 1.0f);
+    ASSERT_EQ(color.r, 0.25f);
+    ASSERT_EQ(color.g, 0.5f);
+    ASSERT_EQ(color.b, 0.75f);
+
+    expect_linear_growth(
+        [](int n) {
+            // The size is the number of pixels / 256, the texture is square.
+            const int side = static_cast<int>(std::sqrt(n * 256.0));
+            Texture texture(side, side, true);
+            BenchmarkUtils::do_not_optimize(texture.get_width());
+        },
+        256);
+}
+
+TEST(Texture, CpuOnlyLoadFlipsRows) {
+    // A 2x2 image stored from the top row: red and blue on the top, green and blue on the bottom.
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "framework_core_tests_texture.png";
+    const unsigned char pixels[] = {255, 0, 0, 255, 0, 0, 255, 255, 0, 255, 0, 255, 0, 0, 255, 255};
+    ASSERT_NE(stbi_write_png(path.generic_string().data(), 2, 2, 4, pixels, 2 * 4), 0);
+
+    const Texture texture(path, true);
+    std::filesystem::remove(path);
+    ASSERT_EQ(texture.get_width(), 2);
+    ASSERT_EQ(texture.get_height(), 2);
+
+    // The rows are flipped so that the pixel (0, 0) is the bottom left one.
+    const Color bottom_left = texture.get_pixel_color(0, 0);
+    const Color top_left = texture.get_pixel_color(0, 1);
+    EXPECT_EQ(bottom_left.r, 0.0f);
+    EXPECT_EQ(bottom_left.g, 1.0f);
+    EXPECT_EQ(top_left.r, 1.0f);
+    EXPECT_EQ(top_left.g, 0.0f);
+    EXPECT_EQ(texture.get_pixel_color(1, 0).b, 1.0f);
+}
+
+TEST(Texture, CpuOnlyLoadMissingFile) {
+    const Texture texture(std::filesystem::temp_directory_path() / "framework_core_tests_missing.png", true);
+    EXPECT_EQ(texture.get_width(), 0);
+    EXPECT_EQ(texture.get_height(), 0);
+}
+
+TEST(Geometry_Base, Interleaving) {
+    const std::vector<float> positions = {0, 1, 2, 3, 4, 5};
+    const std::vector<float> normals = {6, 7, 8, 9, 10, 11};
+    const std::vector<float> tex_coords = {12, 13, 14, 15};
+    Geometry_Base geometry(GL_TRIANGLES, positions, {}, normals, {}, tex_coords, {}, {});
+    ASSERT_EQ(geometry.draw_arrays_count, 2);
+    ASSERT_EQ(geometry.tangent_loc, -1);
+
+    expect_linear_growth(
+        [](int n) {
+            const std::vector<float> attribute(static_cast<size_t>(n) * 3, 1.0f);
+            const std::vector<float> tex_coords(static_cast<size_t>(n) * 2, 0.5f);
+            Geometry_Base geometry(GL_TRIANGLES, attribute, {}, attribute, {}, tex_coords, attribute, attribute);
+            BenchmarkUtils::do_not_optimize(geometry.draw_arrays_count);
+        },
+        1 << 16);
+}
+
+TEST(ShaderUtils, LoadShaderWithIncludes) {
+    const std::filesystem::path shader_directory = std::filesystem::temp_directory_path() / "framework_core_tests";
+
+    // Loading the same shader twice must give the same result (the loader must not keep any state).
+    const std::filesystem::path path = write_shader(shader_directory, 64);
+    const std::string first = ShaderUtils::load_shader(path);
+    const std::string second = ShaderUtils::load_shader(path);
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(first.find("#pragma include"), std::string::npos);
+    ASSERT_NE(first.find("function_7_0"), std::string::npos);
+
+    expect_linear_growth(
+        [&](int n) {
+            const std::filesystem::path path = shader_directory / std::to_string(n) / "main.glsl";
+            if (!std::filesystem::exists(path)) {
+                write_shader(shader_directory, n);
+            }
+            BenchmarkUtils::do_not_optimize(ShaderUtils::load_shader(path).size());
+        },
+        1 << 12);
+    std::filesystem::remove_all(shader_directory);
+}
+
+TEST(CameraData, Construction) {
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const CameraData camera(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f), view, glm::vec3(0.0f, 0.0f, 5.0f));
+    const glm::mat4 identity = camera.view * camera.view_inv;
+    ASSERT_NEAR(identity[0][0], 1.0f, 1e-5f);
+    ASSERT_NEAR(identity[3][2], 0.0f, 1e-5f);
+    ASSERT_EQ(camera.eye_position.w, 1.0f);
+
+    expect_linear_growth(
+        [](int n) {
+            std::vector<CameraData> cameras;
+            cameras.reserve(n);
+            for (int i = 0; i < n; i++) {
+                const glm::vec3 eye(0.0f, 1.0f, 10.0f + static_cast<float>(i));
+                cameras.emplace_back(glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f), glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), eye);
+            }
+            BenchmarkUtils::do_not_optimize(cameras.size());
+        },
+        1 << 16);
+}
@@ -1,11 +1,74 @@
 #include "application.hpp"
 #include "glm/gtx/color_space.inl"
+#include "utils/profiler.hpp"
 #include "utils/utils.hpp"
-#include "model_ubo.hpp"
+#include <cstddef>
+
+namespace {
+/** The indices of the materials in the buffer with Phong materials (see Application::prepare_materials). */
+const int white_material = 0;
+const int black_material = 1;
+const int red_material = 2;
+
+/** The number of rendered lights. */
+const int lights_count = 3;
+
+/** The number of invocations in one work group of the snow compute shaders (SNOW_GROUP_SIZE in snow.glsl). */
+const int snow_group_size = 256;
+
+/** The seed of the snow; the same seed always gives the same snow. */
+const int snow_seed = 69769;
+
+/** The size of the largest snow particle (in view space). */
+const float particle_size = 0.2f;
+
+/** The number of frames after which the shadow samples repeat (the hashed sample indices stay precise in floats). */
+const int frame_index_period = 256;
+
+/** The smallest scale of the resolution of the ray tracing chosen by the dynamic resolution. */
+const float min_resolution_scale = 0.25f;
+
+/** The fraction of the step towards the ideal scale made in one frame; the measured times are noisy and a few frames old. */
+const float resolution_scale_rate = 0.1f;
+
+/** The relative difference from the target frame time that does not change the scale (the resolution stays stable). */
+const float frame_time_tolerance = 0.05f;
+
+/** The size of the square tiles traced by the wavefront ray tracing, it bounds the sizes of the queues. */
+const int wavefront_tile_size = 512;
+
+/** The number of invocations in one work group of the wavefront stages (WAVEFRONT_GROUP_SIZE in wavefront.glsl). */
+const int wavefront_group_size = 64;
+
+/** The sizes of WavefrontRay, WavefrontHit, and ShadowQuery in wavefront.glsl. */
+const GLsizeiptr wavefront_ray_size = 48;
+const GLsizeiptr wavefront_hit_size = 64;
+const GLsizeiptr shadow_query_size = 8;
+
+/** The layout of WavefrontCounters in wavefront.glsl, the dispatches have the layout of DispatchIndirectCommand. */
+struct WavefrontCounters {
+    GLuint ray_count;
+    GLuint next_ray_count;
+    GLuint shadow_query_count;
+    GLuint next_shadow_query_count;
+    GLuint ray_dispatch[4];
+    GLuint shadow_dispatch[4];
+};
+
+/** The layout of the indirect draw command for glDrawArraysIndirect. */
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first;
+    GLuint base_instance;
+};
+} // namespace
 
 Application::Application(int initial_width, int initial_height, std::vector<std::string> arguments)
     : DefaultApplication(initial_width, initial_height, arguments) {
     Application::compile_shaders();
+    // The scene is prepared with the programs (e.g., the snow is seeded), hence they must be linked first.
+    update_pending_programs(true);
     prepare_cameras();
     prepare_materials();
     prepare_textures();
@@ -16,24 +79,78 @@ Application::Application(int initial_width, int initial_height, std::vector<std:
 }
 
 Application::~Application() {
+    glDeleteBuffers(1, &instances_bo);
+    glDeleteTextures(1, &blue_noise_tex);
+    glDeleteBuffers(1, &particle_positions_bo);
+    glDeleteBuffers(1, &particle_velocities_bo);
+    glDeleteBuffers(1, &visible_particles_bo);
+    glDeleteBuffers(1, &snow_draw_command_bo);
+    glDeleteVertexArrays(1, &particle_vao);
+    glDeleteBuffers(2, wavefront_ray_queue_bos);
+    glDeleteBuffers(1, &wavefront_hit_queue_bo);
+    glDeleteBuffers(1, &wavefront_shadow_queue_bo);
+    glDeleteBuffers(1, &wavefront_counters_bo);
+    glDeleteBuffers(1, &wavefront_colors_bo);
+    glDeleteBuffers(1, &wavefront_primary_hits_bo);
+    glDeleteBuffers(1, &bvh_nodes_bo);
+    glDeleteBuffers(1, &bvh_indices_bo);
+    glDeleteTextures(1, &cpu_color_texture);
+    glDeleteTextures(1, &cpu_depth_texture);
+    glDeleteTextures(1, &scene_depth_texture);
+    glDeleteFramebuffers(1, &scene_depth_framebuffer);
+    glDeleteTextures(1, &ray_tracing_color_texture);
+    glDeleteTextures(2, ray_tracing_depth_textures);
+    glDeleteTextures(2, history_color_textures);
+    glDeleteFramebuffers(2, ray_tracing_framebuffers);
+    glDeleteFramebuffers(2, history_framebuffers);
+    glDeleteTextures(1, &gbuffer_position_texture);
+    glDeleteTextures(1, &gbuffer_normal_texture);
+    glDeleteTextures(1, &gbuffer_material_texture);
+    glDeleteTextures(1, &gbuffer_depth_texture);
+    glDeleteFramebuffers(1, &gbuffer_framebuffer);
+    glDeleteTextures(1, &scaled_color_texture);
+    glDeleteTextures(1, &scaled_depth_texture);
+    glDeleteFramebuffers(1, &scaled_framebuffer);
+    glDeleteTextures(1, &interleaved_color_texture);
+    glDeleteTextures(1, &interleaved_normal_texture);
+    glDeleteTextures(1, &interleaved_depth_texture);
+    glDeleteFramebuffers(1, &interleaved_framebuffer);
 }
 
 // ----------------------------------------------------------------------------
 // Shaderes
 // ----------------------------------------------------------------------------
 void Application::compile_shaders() {
-    default_unlit_program = ShaderProgram(shaders_path / "object.vert", shaders_path / "unlit.frag");
-    default_lit_program = ShaderProgram(shaders_path / "object.vert", shaders_path / "lit.frag");
-    
-    particle_textured_program = ShaderProgram();
-    particle_textured_program.add_vertex_shader(shaders_path / "particle_textured.vert");
-    particle_textured_program.add_fragment_shader(shaders_path / "particle_textured.frag");
-    particle_textured_program.add_geometry_shader(shaders_path / "particle_textured.geom");
-    particle_textured_program.link();
-
-    ray_tracing_program = ShaderProgram(shaders_path / "full_screen_quad.vert", shaders_path / "ray_tracing.frag");
-    
-    std::cout << "Shaders are reloaded." << std::endl;
+    // The programs are linked in the background (in parallel if the driver supports it), the current programs are used
+    // until all new ones are linked (see DefaultApplication::update_pending_programs).
+    reload_program(default_unlit_program, shaders_path / "instanced_object.vert", shaders_path / "unlit.frag");
+    reload_program(default_lit_program, shaders_path / "instanced_object.vert", shaders_path / "lit.frag");
+
+    ShaderProgram new_particle_textured_program;
+    new_particle_textured_program.add_vertex_shader(shaders_path / "particle_textured.vert");
+    new_particle_textured_program.add_fragment_shader(shaders_path / "particle_textured.frag");
+    new_particle_textured_program.add_geometry_shader(shaders_path / "particle_textured.geom");
+    reload_program(particle_textured_program, std::move(new_particle_textured_program));
+
+    reload_program(particle_quad_program, shaders_path / "particle_quad.vert", shaders_path / "particle_textured.frag");
+
+    reload_compute_program(snow_seed_program, shaders_path / "snow_seed.comp");
+    reload_compute_program(snow_simulate_program, shaders_path / "snow_simulate.comp");
+    reload_compute_program(snow_cull_program, shaders_path / "snow_cull.comp");
+
+    reload_program(ray_tracing_program, shaders_path / "full_screen_quad.vert", shaders_path / "ray_tracing.frag");
+    reload_program(display_cpu_program, shaders_path / "full_screen_quad.vert", shaders_path / "display_cpu.frag");
+    reload_program(temporal_accumulation_program, shaders_path / "full_screen_quad.vert", shaders_path / "temporal_accumulation.frag");
+    reload_program(interleaved_reconstruction_program, shaders_path / "full_screen_quad.vert", shaders_path / "interleaved_reconstruction.frag");
+    reload_program(gbuffer_program, shaders_path / "instanced_object.vert", shaders_path / "gbuffer.frag");
+
+    reload_compute_program(wavefront_generate_program, shaders_path / "wavefront_generate.comp");
+    reload_compute_program(wavefront_intersect_program, shaders_path / "wavefront_intersect.comp");
+    reload_compute_program(wavefront_shade_program, shaders_path / "wavefront_shade.comp");
+    reload_compute_program(wavefront_advance_program, shaders_path / "wavefront_advance.comp");
+    reload_compute_program(wavefront_shadow_program, shaders_path / "wavefront_shadow.comp");
+
+    reload_program(wavefront_resolve_program, shaders_path / "full_screen_quad.vert", shaders_path / "wavefront_resolve.frag");
 }
 
 // ----------------------------------------------------------------------------
@@ -64,17 +181,36 @@ void Application::prepare_materials() {
     snowman.materials[10] = carrot_material;
     snowman.materials[11] = carrot_material;
     snowman.materials[12] = carrot_material;
+
+    // Note that the rasterization uses simpler Phong materials, their order must match the indices defined above.
+    phong_materials_ssbo = UBO<PhongMaterialData>(
+        {white_material_ubo.get_data()[0], black_material_ubo.get_data()[0], red_material_ubo.get_data()[0]}, 0, GL_SHADER_STORAGE_BUFFER);
 }
 
 void Application::prepare_textures() {
     particle_tex = TextureUtils::load_texture_2d(textures_path / "snowflake.png");
     TextureUtils::set_texture_2d_parameters(particle_tex, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
 
+    // The noise is read per pixel, hence it must not be filtered.
+    blue_noise_tex = TextureUtils::load_texture_2d(textures_path / "noise.png");
+    TextureUtils::set_texture_2d_parameters(blue_noise_tex, GL_REPEAT, GL_REPEAT, GL_NEAREST, GL_NEAREST);
+
 }
 
 void Application::prepare_lights() {
     phong_lights_ubo = PhongLightsUBO(3, GL_UNIFORM_BUFFER);
     phong_lights_ubo.set_global_ambient(glm::vec3(0.2f));
+
+    // The colors are otherwise set only when the GUI is rendered, i.e., after the first update.
+    light_colors[0] = glm::make_vec4(light1_color_array);
+    light_colors[1] = glm::make_vec4(light2_color_array);
+    light_colors[2] = glm::make_vec4(light3_color_array);
+}
+
+void Application::update_rectangular_lights() {
+    // The buffer keeps its storage (see prepare_scene), only the radiance of the soft box follows the intensity.
+    rectangular_lights_ssbo.get_data()[0].radiance = glm::vec4(glm::vec3(rectangular_light_intensity), 1.0f);
+    rectangular_lights_ssbo.update_opengl_data();
 }
 
 void Application::prepare_snowman() {
@@ -99,34 +235,211 @@ void Application::prepare_snowman() {
 }
 
 void Application::prepare_scene() {
-    snowman_ubo = SnowmanUBO(snowman, GL_DYNAMIC_STORAGE_BIT);
+    prepare_snowman_field();
 
-    // Allocates GPU buffers.
+    // A soft box above the camera side of the snowman, its buffer is allocated only once (see update_rectangular_lights).
+    const RectangularLightData soft_box =
+        RectangularLightData::CreateFacing(glm::vec3(0.0f, 9.0f, 8.0f), glm::vec3(0.0f, 3.0f, 0.0f), 6.0f, 3.0f, glm::vec3(rectangular_light_intensity));
+    rectangular_lights_ssbo = UBO<RectangularLightData>(std::vector<RectangularLightData>{soft_box}, GL_DYNAMIC_STORAGE_BIT, GL_SHADER_STORAGE_BUFFER);
+
+    // Allocates GPU buffers, the particles never leave the GPU.
     glCreateBuffers(1, &particle_positions_bo);
-    glNamedBufferStorage(particle_positions_bo, sizeof(float) * 4 * max_snow_count, nullptr, GL_DYNAMIC_STORAGE_BIT);
-   
-    // Initialize positions and velocities, and uploads them into OpenGL buffers.
+    glNamedBufferStorage(particle_positions_bo, sizeof(glm::vec4) * max_snow_count, nullptr, 0);
+    glCreateBuffers(1, &particle_velocities_bo);
+    glNamedBufferStorage(particle_velocities_bo, sizeof(glm::vec4) * max_snow_count, nullptr, 0);
+    glCreateBuffers(1, &visible_particles_bo);
+    glNamedBufferStorage(visible_particles_bo, sizeof(GLuint) * max_snow_count, nullptr, 0);
+    glCreateBuffers(1, &snow_draw_command_bo);
+    glNamedBufferStorage(snow_draw_command_bo, sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // Initialize positions and velocities on GPU.
     reset_particles();
 
     glCreateVertexArrays(1, &particle_vao);
 
-    glVertexArrayVertexBuffer(particle_vao, 0, particle_positions_bo, 0, 4 * sizeof(float));
+    // Allocates the queues of the wavefront ray tracing for one tile, they never leave the GPU either.
+    const GLsizeiptr tile_rays = wavefront_tile_size * wavefront_tile_size;
+    glCreateBuffers(2, wavefront_ray_queue_bos);
+    glNamedBufferStorage(wavefront_ray_queue_bos[0], wavefront_ray_size * tile_rays, nullptr, 0);
+    glNamedBufferStorage(wavefront_ray_queue_bos[1], wavefront_ray_size * tile_rays, nullptr, 0);
+    glCreateBuffers(1, &wavefront_hit_queue_bo);
+    glNamedBufferStorage(wavefront_hit_queue_bo, wavefront_hit_size * tile_rays, nullptr, 0);
+    glCreateBuffers(1, &wavefront_counters_bo);
+    glNamedBufferStorage(wavefront_counters_bo, sizeof(WavefrontCounters), nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+void Application::prepare_snowman_field() {
+    snowman_field = SnowmanField::generate(snowman, current_snowman_count);
+    spheres_ssbo = UBO<glm::vec4>(snowman_field.spheres, 0, GL_SHADER_STORAGE_BUFFER);
+    sphere_materials_ssbo = UBO<PBRMaterialData>(snowman_field.materials, 0, GL_SHADER_STORAGE_BUFFER);
+    prepare_instances();
+    build_bvh();
+    cpu_ray_tracer.set_scene(snowman_field);
+}
+
+void Application::prepare_instances() {
+    std::vector<InstanceData> instances(snowman_field.size() + 1 + lights_count);
+
+    // The spheres of the snowmen.
+    for (int i = 0; i < snowman_field.size(); i++) {
+        const glm::vec4 sph = snowman_field.spheres[i];
+        const int id = i % snowman_size;
+        instances[i].model = translate(glm::mat4(1.0f), glm::vec3(sph)) * scale(glm::mat4(1.0f), glm::vec3(sph.w));
+        instances[i].material = id < 5 ? white_material : (id < 10 ? black_material : red_material);
+    }
+
+    // The floor.
+    InstanceData& floor = instances[snowman_field.size()];
+    floor.model = translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f, 0.0f)) * scale(glm::mat4(1.0f), glm::vec3(30.0f, 0.1f, 30.0f));
+    floor.material = white_material;
+
+    // The lights are moving, hence their matrices are uploaded every frame in update_light_instances.
+    for (int i = 0; i < lights_count; i++) {
+        instances[snowman_field.size() + 1 + i].material = white_material;
+    }
 
-    glEnableVertexArrayAttrib(particle_vao, 0);
-    glVertexArrayAttribFormat(particle_vao, 0, 4, GL_FLOAT, GL_FALSE, 0);
-    glVertexArrayAttribBinding(particle_vao, 0, 0);
+    // The buffer is recreated only when the number of spheres changes.
+    glDeleteBuffers(1, &instances_bo);
+    glCreateBuffers(1, &instances_bo);
+    glNamedBufferStorage(instances_bo, sizeof(InstanceData) * instances.size(), instances.data(), GL_DYNAMIC_STORAGE_BIT);
 }
 
 void Application::prepare_framebuffers() {
+    glCreateFramebuffers(1, &scene_depth_framebuffer);
+    glCreateFramebuffers(2, ray_tracing_framebuffers);
+    glCreateFramebuffers(2, history_framebuffers);
+    glCreateFramebuffers(1, &gbuffer_framebuffer);
+    glCreateFramebuffers(1, &scaled_framebuffer);
+    glCreateFramebuffers(1, &interleaved_framebuffer);
+    const GLenum interleaved_draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glNamedFramebufferDrawBuffers(interleaved_framebuffer, 2, interleaved_draw_buffers);
+    const GLenum gbuffer_draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+    glNamedFramebufferDrawBuffers(gbuffer_framebuffer, 3, gbuffer_draw_buffers);
+    resize_fullscreen_textures();
 }
 
 void Application::resize_fullscreen_textures() {
+    // Removes the previously allocated textures (if any).
+    glDeleteTextures(1, &cpu_color_texture);
+    glDeleteTextures(1, &cpu_depth_texture);
+
+    // Creates new textures for the images computed by the CPU ray tracer.
+    glCreateTextures(GL_TEXTURE_2D, 1, &cpu_color_texture);
+    glTextureStorage2D(cpu_color_texture, 1, GL_RGBA32F, width, height);
+    TextureUtils::set_texture_2d_parameters(cpu_color_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &cpu_depth_texture);
+    glTextureStorage2D(cpu_depth_texture, 1, GL_R32F, width, height);
+    TextureUtils::set_texture_2d_parameters(cpu_depth_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+    // The format matches the depth of the window and the offline framebuffer so that the depth can be blitted.
+    glDeleteTextures(1, &scene_depth_texture);
+    glCreateTextures(GL_TEXTURE_2D, 1, &scene_depth_texture);
+    glTextureStorage2D(scene_depth_texture, 1, GL_DEPTH24_STENCIL8, width, height);
+    TextureUtils::set_texture_2d_parameters(scene_depth_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(scene_depth_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, scene_depth_texture, 0);
+
+    // Creates the textures for the temporal accumulation, the depth is blitted into the output framebuffer as well.
+    glDeleteTextures(1, &ray_tracing_color_texture);
+    glDeleteTextures(2, ray_tracing_depth_textures);
+    glDeleteTextures(2, history_color_textures);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &ray_tracing_color_texture);
+    glTextureStorage2D(ray_tracing_color_texture, 1, GL_RGBA16F, width, height);
+    TextureUtils::set_texture_2d_parameters(ray_tracing_color_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+
+    glCreateTextures(GL_TEXTURE_2D, 2, ray_tracing_depth_textures);
+    glCreateTextures(GL_TEXTURE_2D, 2, history_color_textures);
+    for (int i = 0; i < 2; i++) {
+        glTextureStorage2D(ray_tracing_depth_textures[i], 1, GL_DEPTH24_STENCIL8, width, height);
+        TextureUtils::set_texture_2d_parameters(ray_tracing_depth_textures[i], GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+        glNamedFramebufferTexture(ray_tracing_framebuffers[i], GL_COLOR_ATTACHMENT0, ray_tracing_color_texture, 0);
+        glNamedFramebufferTexture(ray_tracing_framebuffers[i], GL_DEPTH_STENCIL_ATTACHMENT, ray_tracing_depth_textures[i], 0);
+
+        // The history is reprojected to arbitrary positions, hence it is filtered.
+        glTextureStorage2D(history_color_textures[i], 1, GL_RGBA16F, width, height);
+        TextureUtils::set_texture_2d_parameters(history_color_textures[i], GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
+        glNamedFramebufferTexture(history_framebuffers[i], GL_COLOR_ATTACHMENT0, history_color_textures[i], 0);
+    }
+
+    // The new textures do not contain any history.
+    history_valid = false;
+
+    // Creates the textures for the dynamic resolution, the colors are filtered when upscaled.
+    glDeleteTextures(1, &scaled_color_texture);
+    glDeleteTextures(1, &scaled_depth_texture);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &scaled_color_texture);
+    glTextureStorage2D(scaled_color_texture, 1, GL_RGBA16F, width, height);
+    TextureUtils::set_texture_2d_parameters(scaled_color_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
+    glNamedFramebufferTexture(scaled_framebuffer, GL_COLOR_ATTACHMENT0, scaled_color_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &scaled_depth_texture);
+    glTextureStorage2D(scaled_depth_texture, 1, GL_DEPTH24_STENCIL8, width, height);
+    TextureUtils::set_texture_2d_parameters(scaled_depth_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(scaled_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, scaled_depth_texture, 0);
+
+    // Creates the textures for the interleaved rendering, the new textures contain no traced pixels.
+    glDeleteTextures(1, &interleaved_color_texture);
+    glDeleteTextures(1, &interleaved_normal_texture);
+    glDeleteTextures(1, &interleaved_depth_texture);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &interleaved_color_texture);
+    glTextureStorage2D(interleaved_color_texture, 1, GL_RGBA16F, width, height);
+    TextureUtils::set_texture_2d_parameters(interleaved_color_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(interleaved_framebuffer, GL_COLOR_ATTACHMENT0, interleaved_color_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &interleaved_normal_texture);
+    glTextureStorage2D(interleaved_normal_texture, 1, GL_RGBA16F, width, height);
+    TextureUtils::set_texture_2d_parameters(interleaved_normal_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(interleaved_framebuffer, GL_COLOR_ATTACHMENT1, interleaved_normal_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &interleaved_depth_texture);
+    glTextureStorage2D(interleaved_depth_texture, 1, GL_DEPTH24_STENCIL8, width, height);
+    TextureUtils::set_texture_2d_parameters(interleaved_depth_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(interleaved_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, interleaved_depth_texture, 0);
+    interleaved_history_valid = false;
+
+    // Creates the per-pixel buffers of the wavefront ray tracing.
+    glDeleteBuffers(1, &wavefront_colors_bo);
+    glDeleteBuffers(1, &wavefront_primary_hits_bo);
+    glCreateBuffers(1, &wavefront_colors_bo);
+    glNamedBufferStorage(wavefront_colors_bo, sizeof(GLuint) * 3 * width * height, nullptr, 0);
+    glCreateBuffers(1, &wavefront_primary_hits_bo);
+    glNamedBufferStorage(wavefront_primary_hits_bo, sizeof(glm::vec2) * width * height, nullptr, 0);
+
+    // Creates the G-buffer, it is read per pixel by the ray tracing.
+    glDeleteTextures(1, &gbuffer_position_texture);
+    glDeleteTextures(1, &gbuffer_normal_texture);
+    glDeleteTextures(1, &gbuffer_material_texture);
+    glDeleteTextures(1, &gbuffer_depth_texture);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &gbuffer_position_texture);
+    glTextureStorage2D(gbuffer_position_texture, 1, GL_RGBA32F, width, height);
+    TextureUtils::set_texture_2d_parameters(gbuffer_position_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT0, gbuffer_position_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &gbuffer_normal_texture);
+    glTextureStorage2D(gbuffer_normal_texture, 1, GL_RGBA16F, width, height);
+    TextureUtils::set_texture_2d_parameters(gbuffer_normal_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT1, gbuffer_normal_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &gbuffer_material_texture);
+    glTextureStorage2D(gbuffer_material_texture, 1, GL_R32I, width, height);
+    TextureUtils::set_texture_2d_parameters(gbuffer_material_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT2, gbuffer_material_texture, 0);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &gbuffer_depth_texture);
+    glTextureStorage2D(gbuffer_depth_texture, 1, GL_DEPTH_COMPONENT32F, width, height);
+    TextureUtils::set_texture_2d_parameters(gbuffer_depth_texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_NEAREST, GL_NEAREST);
+    glNamedFramebufferTexture(gbuffer_framebuffer, GL_DEPTH_ATTACHMENT, gbuffer_depth_texture, 0);
 }
 
 // ----------------------------------------------------------------------------
 // Update
 // ----------------------------------------------------------------------------
 void Application::update(float delta) {
+    ProfileScope scope("update");
     DefaultApplication::update(delta);
 
     // Updates the main camera.
@@ -155,39 +468,94 @@ void Application::update(float delta) {
 
     phong_lights_ubo.update_opengl_data();
 
+    // The existing particles keep falling when the count changes, only the added ones are seeded.
     if (desired_snow_count != current_snow_count) {
+        if (desired_snow_count > current_snow_count) {
+            seed_particles(current_snow_count, desired_snow_count - current_snow_count);
+        }
         current_snow_count = desired_snow_count;
-        reset_particles();
     }
-}
 
-void Application::reset_particles() {
-    // Sets the seed. We set it here to ensure that though all particles are at random places, they are always at the same places when they are reset.
-    srand(69769);
-    particle_positions.resize(desired_snow_count, glm::vec4(0.0f));
-    // The points are uniformly distributed on the surface of a unit sphere, and their initial velocity is zero.
-    for (int i = 0; i < current_snow_count; i++) {
-        float x = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 60.0f - 30.0f;
-        float y = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 60.0f;
-        float z = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 60.0f - 30.0f;
+    if (show_snow) {
+        simulate_particles(delta);
+    }
 
-        particle_positions[i] = glm::vec4(x,y,z, 1.0f);
+    if (desired_snowman_count != current_snowman_count) {
+        current_snowman_count = desired_snowman_count;
+        prepare_snowman_field();
     }
+}
+
+void Application::reset_particles() { seed_particles(0, current_snow_count); }
 
-    // Updates the OpenGL buffers.
-    glNamedBufferSubData(particle_positions_bo, 0, sizeof(glm::vec4) * current_snow_count, particle_positions.data());
+void Application::seed_particles(int first, int count) {
+    snow_seed_program.use();
+    snow_seed_program.uniform("first_particle", first);
+    snow_seed_program.uniform("particle_count", count);
+    snow_seed_program.uniform("seed", snow_seed);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, particle_positions_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, particle_velocities_bo);
+    glDispatchCompute((count + snow_group_size - 1) / snow_group_size, 1, 1);
+
+    // The seeded particles are simulated and drawn next.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void Application::simulate_particles(float delta) {
+    ProfileScope scope("Snow Simulation", &gpu_timer);
+
+    snow_simulate_program.use();
+    snow_simulate_program.uniform("particle_count", current_snow_count);
+    snow_simulate_program.uniform("delta", delta * 0.001f);
+    snow_simulate_program.uniform("time", static_cast<float>(elapsed_time * 0.001));
+    snow_simulate_program.uniform("wind", wind);
+    snow_simulate_program.uniform("turbulence", turbulence);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, particle_positions_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, particle_velocities_bo);
+    glDispatchCompute((current_snow_count + snow_group_size - 1) / snow_group_size, 1, 1);
+
+    // The positions are read as vertex attributes when the snow is rendered.
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    glUseProgram(0);
+}
+
+void Application::bind_spheres() {
+    spheres_ssbo.bind_buffer_base(3);
+    sphere_materials_ssbo.bind_buffer_base(4);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, bvh_nodes_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, bvh_indices_bo);
 }
 
+void Application::update_light_instances() {
+    InstanceData lights[lights_count] = {};
+    for (int i = 0; i < lights_count; i++) {
+        lights[i].model = translate(glm::mat4(1.0f), glm::vec3(phong_lights_ubo.get_light(i).position)) * scale(glm::mat4(1.0f), glm::vec3(0.1f));
+        lights[i].material = white_material;
+    }
+    glNamedBufferSubData(instances_bo, sizeof(InstanceData) * (snowman_field.size() + 1), sizeof(lights), lights);
+}
+
+void Application::build_bvh() {
+    snowman_bvh.build(snowman_field.spheres.data(), snowman_field.size());
+    const std::vector<BVHNode>& nodes = snowman_bvh.get_nodes();
+    const std::vector<int>& indices = snowman_bvh.get_indices();
+
+    // The buffers are immutable, hence they are recreated whenever the hierarchy changes.
+    glDeleteBuffers(1, &bvh_nodes_bo);
+    glDeleteBuffers(1, &bvh_indices_bo);
+    glCreateBuffers(1, &bvh_nodes_bo);
+    glNamedBufferStorage(bvh_nodes_bo, sizeof(BVHNode) * nodes.size(), nodes.data(), 0);
+    glCreateBuffers(1, &bvh_indices_bo);
+    // Note that an empty buffer cannot be bound as a storage buffer, hence at least one index is allocated.
+    glNamedBufferStorage(bvh_indices_bo, sizeof(int) * std::max<size_t>(1, indices.size()), indices.empty() ? nullptr : indices.data(), 0);
+}
 
 // ----------------------------------------------------------------------------
 // Render
 // ----------------------------------------------------------------------------
 void Application::render() {
-    // Starts measuring the elapsed time.
-    glBeginQuery(GL_TIME_ELAPSED, render_time_query);
-
-    // Binds the main window framebuffer.
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Binds the output framebuffer (the main window unless rendering offline).
+    glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
     glViewport(0, 0, width, height);
 
     // Clears the framebuffer color.
@@ -202,8 +570,32 @@ void Application::render() {
     camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
     phong_lights_ubo.bind_buffer_base(PhongLightsUBO::DEFAULT_LIGHTS_BINDING);
 
+    // The history is valid only if the previous frame was accumulated as well.
+    if (!use_raytracing || use_cpu_raytracing || !use_temporal_accumulation) {
+        history_valid = false;
+    }
+    // Similarly, the interleaved pixels are valid only if the previous frame was interleaved as well.
+    if (!use_raytracing || use_cpu_raytracing || use_wavefront_raytracing || interleaving_period == 1) {
+        interleaved_history_valid = false;
+    }
+
     if (use_raytracing) {
-        raytrace_snowman();
+        if (use_cpu_raytracing) {
+            raytrace_snowman_cpu();
+        } else {
+            update_render_resolution();
+            if (use_hybrid_rendering && !use_wavefront_raytracing) {
+                render_gbuffer();
+            }
+            raytrace_snowman();
+            if (use_temporal_accumulation) {
+                accumulate_frame();
+            }
+        }
+        if (compare_with_cpu) {
+            compare_with_cpu_reference();
+            compare_with_cpu = false;
+        }
     }
     else {
         raster_snowman();
@@ -215,131 +607,464 @@ void Application::render() {
     // Resets the VAO and the program.
     glBindVertexArray(0);
     glUseProgram(0);
-
-    // Stops measuring the elapsed time.
-    glEndQuery(GL_TIME_ELAPSED);
-
-    // Waits for OpenGL - don't forget OpenGL is asynchronous.
-    glFinish();
-
-    // Evaluates the query.
-    GLuint64 render_time;
-    glGetQueryObjectui64v(render_time_query, GL_QUERY_RESULT, &render_time);
-    fps_gpu = 1000.f / (static_cast<float>(render_time) * 1e-6f);
 }
 
 void Application::raytrace_snowman() {
-    // Binds the main window framebuffer.
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, width, height);
+    ProfileScope scope("Ray Tracing", &gpu_timer);
+
+    // The accumulated frames use different shadow samples, the other frames always use the same ones.
+    frame_index = use_temporal_accumulation ? (frame_index + 1) % frame_index_period : 0;
+
+    // Binds the output framebuffer (the main window unless rendering offline), or the offscreen framebuffer if the
+    // frame is accumulated (the result is copied into the output framebuffer in accumulate_frame). The scaled image
+    // is rendered into its own framebuffer and upscaled into the target one at the end.
+    const GLuint target_framebuffer = use_temporal_accumulation ? ray_tracing_framebuffers[history_index] : output_framebuffer;
+    const bool scaled = render_width != width || render_height != height;
+    const GLuint framebuffer = scaled ? scaled_framebuffer : target_framebuffer;
+
+    // The interleaved rendering traces only some pixels into its own framebuffer, the others are reconstructed into the
+    // framebuffer above. All pixels are traced first (or again after a change of the resolution).
+    const bool interleaved = interleaving_period > 1 && !use_wavefront_raytracing;
+    const glm::ivec2 resolution(render_width, render_height);
+    if (!interleaved_history_valid || interleaved_resolution != resolution) {
+        interleaving_phase = 0;
+    } else {
+        interleaving_phase = (interleaving_phase + 1) % interleaving_period;
+    }
+    const int traced_period = interleaved && interleaved_history_valid && interleaved_resolution == resolution ? interleaving_period : 1;
 
-    // Clears the framebuffer color.
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, interleaved ? interleaved_framebuffer : framebuffer);
+    glViewport(0, 0, render_width, render_height);
+
+    // Clears the framebuffer color (the interleaved pixels that are not traced keep their values).
+    if (!interleaved) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
     // We do not need depth and depth test.
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_ALWAYS);
 
-    // Uses the proper program.
-    ray_tracing_program.use();
-    ray_tracing_program.uniform("resolution", glm::vec2(width, height));
-    ray_tracing_program.uniform("spheres_count", static_cast<int>(13));
-    ray_tracing_program.uniform("use_ambient_occlusion", use_ambient_occlusion);
-    ray_tracing_program.uniform("iterations", reflections);
-    ray_tracing_program.uniform("sphere_light_radius", sphere_light_radius);
-    ray_tracing_program.uniform("shadow_samples", shadow_samples);
-
     // Binds the data with the camera and the lights.
     camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
     phong_lights_ubo.bind_buffer_base(PhongLightsUBO::DEFAULT_LIGHTS_BINDING);
-
-    // Binds the buffers containing the information about the spheres (positions + radii and materials).
-    //glBindBufferBase(GL_UNIFORM_BUFFER, 4, snowman_ubo);
-    snowman_ubo.bind_buffer_base(4);
+    rectangular_lights_ssbo.bind_buffer_base(13);
+    glBindTextureUnit(0, blue_noise_tex);
+
+    // Binds the buffers containing the information about the spheres (positions + radii and materials) and the BVH.
+    bind_spheres();
+
+    if (use_wavefront_raytracing) {
+        // Traces the pixels in compute shaders, the full screen quad then only writes the results.
+        trace_wavefront();
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        wavefront_resolve_program.use();
+        wavefront_resolve_program.uniform("resolution", glm::vec2(render_width, render_height));
+    } else {
+        // Uses the proper program.
+        ray_tracing_program.use();
+        set_ray_tracing_uniforms(ray_tracing_program);
+        ray_tracing_program.uniform("use_gbuffer", use_hybrid_rendering);
+        ray_tracing_program.uniform("interleaving_period", traced_period);
+        ray_tracing_program.uniform("interleaving_phase", interleaving_phase);
+        glBindTextureUnit(1, gbuffer_position_texture);
+        glBindTextureUnit(2, gbuffer_normal_texture);
+        glBindTextureUnit(3, gbuffer_material_texture);
+    }
 
     // Renders the full screen quad to evaluate every pixel.
     // Binds an empty VAO as we do not need any state.
     glBindVertexArray(empty_vao);
     // Calls a draw command with 3 vertices that are generated in vertex shader.
     glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (interleaved) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        interleaved_reconstruction_program.uniform("interleaving_period", traced_period);
+        interleaved_reconstruction_program.uniform("interleaving_phase", interleaving_phase);
+        reconstruct_interleaved_frame();
+        interleaved_history_valid = true;
+        interleaved_resolution = resolution;
+    }
+
+    if (scaled) {
+        // The colors are filtered, the depths cannot be (the snow is tested against them, hence they stay sharp).
+        ProfileScope upscale_scope("Upscaling", &gpu_timer);
+        glBlitNamedFramebuffer(scaled_framebuffer, target_framebuffer, 0, 0, render_width, render_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                               GL_LINEAR);
+        glBlitNamedFramebuffer(scaled_framebuffer, target_framebuffer, 0, 0, render_width, render_height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT,
+                               GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer);
+        glViewport(0, 0, width, height);
+    }
+}
+
+void Application::update_render_resolution() {
+    const float frame_time = gpu_timer.get_frame_time();
+    if (!use_dynamic_resolution) {
+        resolution_scale = 1.0f;
+    } else if (frame_time > 0.0f && std::abs(frame_time - target_frame_time) > frame_time_tolerance * target_frame_time) {
+        // The time of the ray tracing is roughly proportional to the number of pixels, i.e., to the square of the scale.
+        const float ideal_scale = resolution_scale * std::sqrt(target_frame_time / frame_time);
+        resolution_scale = glm::clamp(glm::mix(resolution_scale, ideal_scale, resolution_scale_rate), min_resolution_scale, 1.0f);
+    }
+    render_width = std::max(1, static_cast<int>(std::round(width * resolution_scale)));
+    render_height = std::max(1, static_cast<int>(std::round(height * resolution_scale)));
+}
+
+void Application::set_ray_tracing_uniforms(const ShaderProgram& program) {
+    program.uniform("resolution", glm::vec2(render_width, render_height));
+    program.uniform("spheres_count", snowman_field.size());
+    program.uniform("occlusion_distance", occlusion_distance);
+    program.uniform("use_ambient_occlusion", use_ambient_occlusion);
+    program.uniform("iterations", reflections);
+    program.uniform("sphere_light_radius", sphere_light_radius);
+    program.uniform("shadow_samples", shadow_samples);
+    program.uniform("use_analytic_shadows", use_analytic_shadows);
+    program.uniform("frame_index", frame_index);
+    program.uniform("use_blue_noise", use_blue_noise_shadows);
+    program.uniform("use_adaptive_shadows", use_adaptive_shadows);
+    program.uniform("use_throughput_cutoff", use_throughput_cutoff);
+    program.uniform("use_russian_roulette", use_russian_roulette);
+    program.uniform("rectangular_lights_count", static_cast<int>(get_rectangular_lights().size()));
+}
+
+void Application::trace_wavefront() {
+    const ShaderProgram* stages[] = {&wavefront_generate_program, &wavefront_intersect_program, &wavefront_shade_program,
+                                     &wavefront_advance_program, &wavefront_shadow_program};
+    for (const ShaderProgram* stage : stages) {
+        set_ray_tracing_uniforms(*stage);
+    }
+
+    // Every ray may query one shadow per light, the queue is reallocated when the number of rectangular lights changes
+    // (otherwise the shading would drop the queries that do not fit into the queue and darken the image).
+    const int queries_per_ray = lights_count + static_cast<int>(get_rectangular_lights().size());
+    if (queries_per_ray != wavefront_queries_per_ray) {
+        glDeleteBuffers(1, &wavefront_shadow_queue_bo);
+        glCreateBuffers(1, &wavefront_shadow_queue_bo);
+        glNamedBufferStorage(wavefront_shadow_queue_bo, shadow_query_size * queries_per_ray * wavefront_tile_size * wavefront_tile_size, nullptr, 0);
+        wavefront_queries_per_ray = queries_per_ray;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, wavefront_hit_queue_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, wavefront_shadow_queue_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, wavefront_counters_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 19, wavefront_colors_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, wavefront_primary_hits_bo);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, wavefront_counters_bo);
+
+    // The colors are accumulated by all bounces of all tiles. The clear must wait for the shader writes of the previous frame.
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glClearNamedBufferData(wavefront_colors_bo, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    // The queues hold one tile at a time, which bounds their memory independently of the resolution.
+    for (int tile_y = 0; tile_y < render_height; tile_y += wavefront_tile_size) {
+        for (int tile_x = 0; tile_x < render_width; tile_x += wavefront_tile_size) {
+            const glm::ivec2 tile_size(std::min(wavefront_tile_size, render_width - tile_x), std::min(wavefront_tile_size, render_height - tile_y));
+            const GLuint tile_rays = tile_size.x * tile_size.y;
+            const GLuint tile_groups = (tile_rays + wavefront_group_size - 1) / wavefront_group_size;
+
+            // The counts are never read back, the stages consume them through the indirect dispatches. The upload must wait
+            // for the writes of the counters by the previous tile (see 'shaders/wavefront_advance.comp').
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            const WavefrontCounters counters = {tile_rays, 0, 0, 0, {tile_groups, 1, 1, 0}, {0, 1, 1, 0}};
+            glNamedBufferSubData(wavefront_counters_bo, 0, sizeof(WavefrontCounters), &counters);
+
+            {
+                ProfileScope stage_scope("Wavefront Generate", &gpu_timer);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, wavefront_ray_queue_bos[0]);
+                wavefront_generate_program.use();
+                wavefront_generate_program.uniform("tile_origin", glm::ivec2(tile_x, tile_y));
+                wavefront_generate_program.uniform("tile_size", tile_size);
+                glDispatchCompute(tile_groups, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+
+            for (int bounce = 0; bounce < reflections; bounce++) {
+                // The reflected rays of this bounce are the rays of the next one.
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, wavefront_ray_queue_bos[bounce % 2]);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, wavefront_ray_queue_bos[(bounce + 1) % 2]);
+                {
+                    ProfileScope stage_scope("Wavefront Intersect", &gpu_timer);
+                    wavefront_intersect_program.use();
+                    glDispatchComputeIndirect(offsetof(WavefrontCounters, ray_dispatch));
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+                {
+                    ProfileScope stage_scope("Wavefront Shade", &gpu_timer);
+                    wavefront_shade_program.use();
+                    wavefront_shade_program.uniform("bounce", bounce);
+                    glDispatchComputeIndirect(offsetof(WavefrontCounters, ray_dispatch));
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                    wavefront_advance_program.use();
+                    glDispatchCompute(1, 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+                }
+                {
+                    ProfileScope stage_scope("Wavefront Shadow", &gpu_timer);
+                    wavefront_shadow_program.use();
+                    glDispatchComputeIndirect(offsetof(WavefrontCounters, shadow_dispatch));
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+            }
+        }
+    }
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+void Application::render_gbuffer() {
+    ProfileScope scope("G-Buffer", &gpu_timer);
+
+    // The primary rays are generated with the vertical field of view of 90 degrees (see the main method of
+    // 'shaders/ray_tracing.frag'), the G-buffer is rasterized with the same one so that its pixels match the rays.
+    const CameraData& camera_data = camera_ubo.get_data()[0];
+    const float aspect_ratio = static_cast<float>(render_width) / static_cast<float>(render_height);
+    gbuffer_camera_ubo.set_projection(glm::perspective(glm::radians(90.f), aspect_ratio, 1.0f, 1000.0f));
+    gbuffer_camera_ubo.set_view(camera_data.view);
+    gbuffer_camera_ubo.update_opengl_data();
+
+    // The G-buffer has the resolution of the ray traced image (see update_render_resolution).
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer_framebuffer);
+    glViewport(0, 0, render_width, render_height);
+
+    // The material -1 marks the pixels without any rasterized surface, they are evaluated by the primary rays.
+    const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLint no_material[4] = {-1, -1, -1, -1};
+    const GLfloat far_depth = 1.0f;
+    glClearNamedFramebufferfv(gbuffer_framebuffer, GL_COLOR, 0, zero);
+    glClearNamedFramebufferfv(gbuffer_framebuffer, GL_COLOR, 1, zero);
+    glClearNamedFramebufferiv(gbuffer_framebuffer, GL_COLOR, 2, no_material);
+    glClearNamedFramebufferfv(gbuffer_framebuffer, GL_DEPTH, 0, &far_depth);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    gbuffer_program.use();
+    gbuffer_program.uniform("spheres_count", snowman_field.size());
+    gbuffer_camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, instances_bo);
+    bind_spheres();
+
+    // Renders all spheres of the snowmen with a single draw call, and the floor. The lights are intersected by the rays.
+    gbuffer_program.uniform("first_instance", 0);
+    sphere.draw_instanced(snowman_field.size());
+    gbuffer_program.uniform("first_instance", snowman_field.size());
+    cube.draw_instanced(1);
+
+    // Restores the camera of the scene.
+    camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
+}
+
+void Application::raytrace_snowman_cpu() {
+    ProfileScope scope("Ray Tracing (CPU)", &gpu_timer);
+
+    // Renders the image on all cores.
+    cpu_ray_tracer.render(phong_lights_ubo.get_lights(), get_rectangular_lights(), camera_ubo.get_data()[0], get_cpu_ray_tracer_settings(), width, height);
+
+    // Uploads the result into the textures.
+    glTextureSubImage2D(cpu_color_texture, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, cpu_ray_tracer.get_color().data());
+    glTextureSubImage2D(cpu_depth_texture, 0, 0, 0, width, height, GL_RED, GL_FLOAT, cpu_ray_tracer.get_depth().data());
+
+    // Binds the output framebuffer (the main window unless rendering offline).
+    glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
+    glViewport(0, 0, width, height);
+
+    // The depth is written from the texture so that the snow is still correctly occluded.
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+
+    display_cpu_program.use();
+    glBindTextureUnit(0, cpu_color_texture);
+    glBindTextureUnit(1, cpu_depth_texture);
+
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void Application::reconstruct_interleaved_frame() {
+    ProfileScope scope("Interleaved Reconstruction", &gpu_timer);
+
+    interleaved_reconstruction_program.use();
+    interleaved_reconstruction_program.uniform("resolution", glm::vec2(render_width, render_height));
+    camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
+    glBindTextureUnit(0, interleaved_color_texture);
+    glBindTextureUnit(1, interleaved_normal_texture);
+    glBindTextureUnit(2, interleaved_depth_texture);
+
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void Application::accumulate_frame() {
+    ProfileScope scope("Temporal Accumulation", &gpu_timer);
+
+    const int previous_index = 1 - history_index;
+
+    // Blends the new frame with the history of the previous frame into the history of the current frame.
+    glBindFramebuffer(GL_FRAMEBUFFER, history_framebuffers[history_index]);
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+
+    temporal_accumulation_program.use();
+    temporal_accumulation_program.uniform("resolution", glm::vec2(width, height));
+    temporal_accumulation_program.uniform_matrix("previous_view", previous_view);
+    temporal_accumulation_program.uniform("use_history", history_valid);
+    temporal_accumulation_program.uniform("history_weight", history_weight);
+    camera_ubo.bind_buffer_base(CameraUBO::DEFAULT_CAMERA_BINDING);
+    glBindTextureUnit(0, ray_tracing_color_texture);
+    glBindTextureUnit(1, ray_tracing_depth_textures[history_index]);
+    glBindTextureUnit(2, history_color_textures[previous_index]);
+    glBindTextureUnit(3, ray_tracing_depth_textures[previous_index]);
+
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // Copies the accumulated colors and the ray traced depth into the output framebuffer, the snow is rendered over them.
+    glBlitNamedFramebuffer(history_framebuffers[history_index], output_framebuffer, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                           GL_NEAREST);
+    glBlitNamedFramebuffer(ray_tracing_framebuffers[history_index], output_framebuffer, 0, 0, width, height, 0, 0, width, height,
+                           GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer);
+    glEnable(GL_DEPTH_TEST);
+
+    // The current frame becomes the history of the next one.
+    previous_view = camera_ubo.get_data()[0].view;
+    history_index = previous_index;
+    history_valid = true;
+}
+
+void Application::compare_with_cpu_reference() {
+    // Reads the image that was just ray traced (rows are returned from bottom to top as in the CPU ray tracer).
+    std::vector<glm::vec4> image(static_cast<size_t>(width) * height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, output_framebuffer);
+    glReadBuffer(output_framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, image.data());
+
+    // Computes the reference unless it was just computed for this frame.
+    if (!use_cpu_raytracing) {
+        cpu_ray_tracer.render(phong_lights_ubo.get_lights(), get_rectangular_lights(), camera_ubo.get_data()[0], get_cpu_ray_tracer_settings(), width,
+                              height);
+    }
+
+    const ImageComparison result = CPURayTracer::compare(cpu_ray_tracer.get_color(), image, compare_tolerance);
+    std::cout << "CPU reference comparison (" << width << "x" << height << "): RMSE " << result.rmse << ", max error " << result.max_error << ", "
+              << result.mismatch_ratio * 100.0f << "% pixels above tolerance " << compare_tolerance << std::endl;
+}
+
+std::vector<RectangularLightData> Application::get_rectangular_lights() {
+    return use_rectangular_light ? rectangular_lights_ssbo.get_data() : std::vector<RectangularLightData>();
+}
+
+CPURayTracerSettings Application::get_cpu_ray_tracer_settings() const {
+    CPURayTracerSettings settings;
+    settings.iterations = reflections;
+    settings.shadow_samples = shadow_samples;
+    settings.use_ambient_occlusion = use_ambient_occlusion;
+    settings.sphere_light_radius = sphere_light_radius;
+    settings.use_analytic_shadows = use_analytic_shadows;
+    settings.frame_index = frame_index;
+    settings.use_adaptive_shadows = use_adaptive_shadows;
+    settings.use_throughput_cutoff = use_throughput_cutoff;
+    settings.use_russian_roulette = use_russian_roulette;
+    settings.occlusion_distance = occlusion_distance;
+    return settings;
 }
 
+void Application::cull_particles() {
+    ProfileScope scope("Snow Culling", &gpu_timer);
+
+    // Copies the depth of the scene, the particles behind it are culled.
+    glBlitNamedFramebuffer(output_framebuffer, scene_depth_framebuffer, 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Resets the draw command, the culling appends the visible particles.
+    const DrawArraysIndirectCommand command = {0, 1, 0, 0};
+    glNamedBufferSubData(snow_draw_command_bo, 0, sizeof(command), &command);
+
+    snow_cull_program.use();
+    snow_cull_program.uniform("particle_count", current_snow_count);
+    // The particles are rotated quads, the sphere bounds their diagonal.
+    snow_cull_program.uniform("particle_radius", particle_size * 0.5f * std::sqrt(2.0f));
+    snow_cull_program.uniform("use_culling", cull_snow);
+    snow_cull_program.uniform("vertices_per_particle", use_snow_vertex_pulling ? 6 : 1);
+    glBindTextureUnit(0, scene_depth_texture);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, particle_positions_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, snow_draw_command_bo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, visible_particles_bo);
+    glDispatchCompute((current_snow_count + snow_group_size - 1) / snow_group_size, 1, 1);
+
+    // The command is read by the indirect draw, the indices by the vertex shader.
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
 
 void Application::render_snow() {
+    cull_particles();
+
+    ProfileScope scope("Snow", &gpu_timer);
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
-    particle_textured_program.use();
-    particle_textured_program.uniform("particle_size_vs", 0.2f);
-    particle_textured_program.uniform("time", static_cast<float>(elapsed_time));
+    // Either the vertices are expanded into quads by the geometry shader, or each quad is pulled by six vertices.
+    const ShaderProgram& program = use_snow_vertex_pulling ? particle_quad_program : particle_textured_program;
+    program.use();
+    program.uniform("particle_size_vs", particle_size);
     glBindTextureUnit(0, particle_tex);
 
-    // Binds the proper VAO (we use the VAO with the data we just wrote).
+    // Binds the VAO without attributes (the particles are read from the buffers bound by the culling).
     glBindVertexArray(particle_vao);
-    // Draws the particles as points.
+    // Draws the visible particles, the count of their vertices is in the draw command.
     glPointSize(1.0f);
-    glDrawArrays(GL_POINTS, 0, current_snow_count);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, snow_draw_command_bo);
+    glDrawArraysIndirect(use_snow_vertex_pulling ? GL_TRIANGLES : GL_POINTS, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
     glDisable(GL_BLEND);
 
 }
 
 void Application::raster_snowman() {
-    int id = 0;
-    // Renders the snowman
-    for (glm::vec4 sph : snowman.spheres) {
-        default_lit_program.use();
-
-        ModelUBO model_ubo(translate(glm::mat4(1.0f), glm::vec3(sph)) * scale(glm::mat4(1.0f), glm::vec3(sph.w)));
-
-        // Handles the textures.
-        default_lit_program.uniform("has_texture", false);
-        default_lit_program.uniform("use_ambient_occlusion", use_ambient_occlusion);
-        snowman_ubo.bind_buffer_base(4);
-        glBindTextureUnit(0, 0);
-
-        // Note that the material are hard-coded here since the default lit shader works with PhongMaterial not PBRMaterial as defined in snowman.
-        if (id < 5) {
-            white_material_ubo.bind_buffer_base(PhongMaterialUBO::DEFAULT_MATERIAL_BINDING);
-        } else if (id < 10){
-            black_material_ubo.bind_buffer_base(PhongMaterialUBO::DEFAULT_MATERIAL_BINDING);
-        }
-        else {
-            red_material_ubo.bind_buffer_base(PhongMaterialUBO::DEFAULT_MATERIAL_BINDING);
-        }
-        model_ubo.bind_buffer_base(ModelUBO::DEFAULT_MODEL_BINDING);
-        sphere.bind_vao();
-        sphere.draw();
-        id++;
-    }
+    ProfileScope scope("Rasterization", &gpu_timer);
+
+    update_light_instances();
+
+    // Binds the data shared by all draw calls.
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, instances_bo);
+    phong_materials_ssbo.bind_buffer_base(8);
+    glBindTextureUnit(0, 0);
+
+    // Renders all spheres of the snowmen with a single draw call.
+    default_lit_program.use();
+    default_lit_program.uniform("has_texture", false);
+    default_lit_program.uniform("use_ambient_occlusion", use_ambient_occlusion);
+    default_lit_program.uniform("occlusion_distance", occlusion_distance);
+    default_lit_program.uniform("rectangular_lights_count", static_cast<int>(get_rectangular_lights().size()));
+    rectangular_lights_ssbo.bind_buffer_base(13);
+    bind_spheres();
+    default_lit_program.uniform("first_instance", 0);
+    sphere.draw_instanced(snowman_field.size());
 
     // Render the floor
-    white_material_ubo.bind_buffer_base(PhongMaterialUBO::DEFAULT_MATERIAL_BINDING);
-    ModelUBO model_ubo(translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f, 0.0f)) * scale(glm::mat4(1.0f), glm::vec3(30.0f, 0.1f, 30.0f)));
-    model_ubo.bind_buffer_base(ModelUBO::DEFAULT_MODEL_BINDING);
-    cube.bind_vao();
-    cube.draw();
+    default_lit_program.uniform("first_instance", snowman_field.size());
+    cube.draw_instanced(1);
 
     // Renders the lights.
-    for (int i = 0; i < 3; i++) {
-        default_unlit_program.use();
-
-        ModelUBO model_ubo(translate(glm::mat4(1.0f), glm::vec3(phong_lights_ubo.get_light(i).position)) * scale(glm::mat4(1.0f), glm::vec3(0.1f)));
-
-        // Note that the material are hard-coded here since the default lit shader works with PhongMaterial not PBRMaterial as defined in snowman.
-        white_material_ubo.bind_buffer_base(PhongMaterialUBO::DEFAULT_MATERIAL_BINDING);
-        model_ubo.bind_buffer_base(ModelUBO::DEFAULT_MODEL_BINDING);
-        sphere.bind_vao();
-        sphere.draw();
-    }
+    default_unlit_program.use();
+    default_unlit_program.uniform("has_texture", false);
+    default_unlit_program.uniform("first_instance", snowman_field.size() + 1);
+    sphere.draw_instanced(lights_count);
 }
 
 // ----------------------------------------------------------------------------
 // GUI
 // ----------------------------------------------------------------------------
 void Application::render_ui() {
+    ProfileScope scope("render_ui");
+
+    // The GUI is drawn after this method returns, the pass ends with the frame.
+    gpu_timer.begin_pass("UI");
+
     const float unit = ImGui::GetFontSize();
 
     ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_NoDecoration);
@@ -354,24 +1079,80 @@ void Application::render_ui() {
     std::string fps_string = "FPS (GPU): ";
     ImGui::Text(fps_string.append(std::to_string(fps_gpu)).c_str());
 
+    // The times of the individual passes (they are a few frames old, like the GPU FPS), the repeated passes (e.g., the
+    // stages of the wavefront ray tracing for every tile and bounce) are summed.
+    for (const GPUPassTime& pass : gpu_timer.get_total_pass_times()) {
+        ImGui::Text("  %s: %.3f ms", pass.name.c_str(), pass.time);
+    }
+
+    // The profiler records the CPU scopes and GPU passes, the trace can be opened in chrome://tracing or Perfetto.
+    bool record_profile = Profiler::get().is_enabled();
+    if (ImGui::Checkbox("Record Profile", &record_profile)) {
+        Profiler::get().set_enabled(record_profile);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Save Trace")) {
+        if (Profiler::get().save("trace.json")) {
+            std::cout << "The trace with " << Profiler::get().get_event_count() << " events is saved into trace.json." << std::endl;
+        } else {
+            std::cerr << "The trace could not be saved." << std::endl;
+        }
+    }
+
     ImGui::SliderInt("Reflections Quality", &reflections, 1, 100);
+    ImGui::Checkbox("Reflection Cutoff", &use_throughput_cutoff);
+    ImGui::SameLine();
+    ImGui::Checkbox("Russian Roulette", &use_russian_roulette);
 
-    const char* particle_labels[10] = {"256", "512", "1024", "2048", "4096", "8192", "16384", "32768", "65536", "131072"};
+    const char* particle_labels[15] = {"256",   "512",    "1024",   "2048",   "4096",    "8192",    "16384",  "32768",
+                                       "65536", "131072", "262144", "524288", "1048576", "2097152", "4194304"};
     int exponent = static_cast<int>(log2(current_snow_count) - 8); // -8 because we start at 256 = 2^8
     if (ImGui::Combo("Particle Count", &exponent, particle_labels, IM_ARRAYSIZE(particle_labels))) {
         desired_snow_count = static_cast<int>(glm::pow(2, exponent + 8)); // +8 because we start at 256 = 2^8
     }
 
+    const char* snowman_labels[6] = {"1", "10", "100", "1000", "10000", "100000"};
+    int snowman_exponent = static_cast<int>(log10(current_snowman_count));
+    if (ImGui::Combo("Snowman Count", &snowman_exponent, snowman_labels, IM_ARRAYSIZE(snowman_labels))) {
+        desired_snowman_count = static_cast<int>(glm::pow(10, snowman_exponent));
+    }
+
     ImGui::Checkbox("Show Snow", &show_snow);
+    ImGui::SliderFloat3("Wind", &wind[0], -5.0f, 5.0f, "%.1f");
+    ImGui::SliderFloat("Turbulence", &turbulence, 0.0f, 2.0f, "%.2f");
+    ImGui::Checkbox("Cull Snow", &cull_snow);
+    ImGui::Checkbox("Snow without Geometry Shader", &use_snow_vertex_pulling);
 
     ImGui::Checkbox("Ambient Occlusion", &use_ambient_occlusion);
+    ImGui::SliderFloat("Occlusion Distance", &occlusion_distance, 1, 50, "%.0f");
     ImGui::Checkbox("Raytracing", &use_raytracing);
+    ImGui::Checkbox("Hybrid (Rasterized Primary Rays)", &use_hybrid_rendering);
+    ImGui::Checkbox("Wavefront Raytracing (Compute)", &use_wavefront_raytracing);
+    const char* interleaving_labels[3] = {"Off", "Half (Checkerboard)", "Quarter (2x2)"};
+    int interleaving_exponent = static_cast<int>(log2(interleaving_period));
+    if (ImGui::Combo("Interleaved Rendering", &interleaving_exponent, interleaving_labels, IM_ARRAYSIZE(interleaving_labels))) {
+        interleaving_period = 1 << interleaving_exponent;
+    }
+    ImGui::Checkbox("Dynamic Resolution", &use_dynamic_resolution);
+    ImGui::SliderFloat("Target Frame Time", &target_frame_time, 5.0f, 100.0f, "%.1f ms");
+    ImGui::Text("  Resolution: %dx%d (%.0f%%)", render_width, render_height, resolution_scale * 100.0f);
+    ImGui::Checkbox("Raytracing on CPU", &use_cpu_raytracing);
+    if (ImGui::Button("Compare with CPU Reference")) {
+        compare_with_cpu = true;
+    }
 
     ImGui::SliderFloat("Sphere Light Radius", &sphere_light_radius, 0, 1, "%.1f");
     ImGui::SliderInt("Shadow Quality", &shadow_samples, 1, 128);
-
-    ImGui::Checkbox("Corrective: Smooth Shadow Edges", &corrective_smooth_shadows);
-    ImGui::Checkbox("Corrective: Rectangular Area Light", &corrective_rectangular_area_light);
+    ImGui::Checkbox("Analytic Soft Shadows", &use_analytic_shadows);
+    ImGui::Checkbox("Adaptive Shadow Samples", &use_adaptive_shadows);
+    ImGui::Checkbox("Temporal Accumulation", &use_temporal_accumulation);
+    ImGui::SliderFloat("History Weight", &history_weight, 0.0f, 0.99f, "%.2f");
+
+    ImGui::Checkbox("Blue Noise Shadows", &use_blue_noise_shadows);
+    ImGui::Checkbox("Rectangular Area Light", &use_rectangular_light);
+    if (ImGui::SliderFloat("Rectangular Light Intensity", &rectangular_light_intensity, 0.0f, 20.0f, "%.1f")) {
+        update_rectangular_lights();
+    }
 
     ImGui::ColorPicker4("Light1 color", light1_color_array);
     ImGui::ColorPicker4("Light2 color", light2_color_array);
@@ -1,21 +1,24 @@
 #pragma once
 #include "camera_ubo.hpp"
+#include "cpu_ray_tracer.hpp"
 #include "default_application.hpp"
 #include "light_ubo.hpp"
 #include "pbr_material_ubo.hpp"
-
-/** The number of spheres forming the snowman. */
-const int snowman_size = 13;
-
-/** The structure defining the snowman. */
-struct Snowman {
-    glm::vec4 spheres[snowman_size];         // The spheres defining the snowman.
-    PBRMaterialData materials[snowman_size]; // The respective materials for each sphere.
-};
-
-/** The definition of a snowman ubo. */
-class SnowmanUBO : public UBO<Snowman> {
-    using UBO<Snowman>::UBO; // copies constructors from the parent class
+#include "rectangular_light.hpp"
+#include "snowman.hpp"
+#include "sphere_bvh.hpp"
+
+/**
+ * The data of one instance rendered by 'shaders/instanced_object.vert'. The layout matches the std430 layout of the
+ * InstanceData structure in the shader.
+ */
+struct InstanceData {
+    /** The model matrix; it may translate, rotate and scale the object but it must not shear it. */
+    glm::mat4 model;
+    /** The index of the material in @link Application::phong_materials_ssbo. */
+    int material;
+    /** The padding to the alignment of the structure. */
+    int padding[3];
 };
 
 class Application : public DefaultApplication {
@@ -23,22 +26,100 @@ class Application : public DefaultApplication {
     // Variables (Geometry)
     // ----------------------------------------------------------------------------
 protected:
-    /** The definition of the snowman. */
+    /** The definition of the snowman (the template for the snowman field). */
     Snowman snowman;
-    /** The buffer with the snowman. */
-    SnowmanUBO snowman_ubo;
-    /** The positions of all particles (on GPU).*/
-    GLuint particle_positions_bo;
-    /**	The positions of all particles (on CPU).*/
-    std::vector<glm::vec4> particle_positions;
-    /** VAOs for rendering particles */
-    GLuint particle_vao;
+    /** The spheres and materials of all snowmen in the scene. */
+    SnowmanField snowman_field;
+    /** The buffer with the spheres of all snowmen. */
+    UBO<glm::vec4> spheres_ssbo;
+    /** The buffer with the materials of all spheres. */
+    UBO<PBRMaterialData> sphere_materials_ssbo;
+    /**
+     * The per-instance data of all rasterized objects: the spheres of the snowmen followed by the floor and the lights.
+     * Only the lights are updated every frame, the rest is rewritten when the snowman field changes.
+     */
+    GLuint instances_bo = 0;
+    /** The Phong materials used by the rasterized instances. */
+    UBO<PhongMaterialData> phong_materials_ssbo;
+    /** The BVH over the snowman spheres (on CPU). */
+    SphereBVH snowman_bvh;
+    /** The nodes of the BVH (on GPU). */
+    GLuint bvh_nodes_bo = 0;
+    /** The sphere indices referenced by the leaves of the BVH (on GPU). */
+    GLuint bvh_indices_bo = 0;
+    /** The positions of all particles (on GPU), they are seeded and simulated by the compute shaders (see snow.glsl).*/
+    GLuint particle_positions_bo = 0;
+    /** The velocities of all particles (on GPU). */
+    GLuint particle_velocities_bo = 0;
+    /** The indices of the particles that survived the culling (on GPU). */
+    GLuint visible_particles_bo = 0;
+    /** The indirect draw command drawing the visible particles, its count is computed by the culling (on GPU). */
+    GLuint snow_draw_command_bo = 0;
+    /** The VAO for rendering particles (without attributes, the vertex shader reads the particles from the buffers). */
+    GLuint particle_vao = 0;
+    /** The ray queues of the wavefront ray tracing, the current and the next one alternate (see 'shaders/wavefront.glsl'). */
+    GLuint wavefront_ray_queue_bos[2] = {0, 0};
+    /** The hits of the rays in the current ray queue. */
+    GLuint wavefront_hit_queue_bo = 0;
+    /** The shadow queries of the current bounce. */
+    GLuint wavefront_shadow_queue_bo = 0;
+    /** The number of shadow queries per ray the shadow queue is allocated for (one per spherical and rectangular light). */
+    int wavefront_queries_per_ray = 0;
+    /** The sizes of the queues and the indirect dispatches of the wavefront stages. */
+    GLuint wavefront_counters_bo = 0;
+    /** The colors of all pixels accumulated by the wavefront ray tracing (in fixed point). */
+    GLuint wavefront_colors_bo = 0;
+    /** The depths and the ambient occlusion of the primary hits of all pixels. */
+    GLuint wavefront_primary_hits_bo = 0;
 
     // ----------------------------------------------------------------------------
     // Variables (Textures)
     // ----------------------------------------------------------------------------
     GLuint particle_tex;
 
+    /** The blue noise texture rotating the shadow samples in every pixel (see 'shaders/noise.glsl'). */
+    GLuint blue_noise_tex = 0;
+
+    /** The colors computed by the CPU ray tracer. */
+    GLuint cpu_color_texture = 0;
+    /** The depth computed by the CPU ray tracer. */
+    GLuint cpu_depth_texture = 0;
+
+    /** The copy of the depth of the scene used for the culling of the snow. */
+    GLuint scene_depth_texture = 0;
+
+    /** The colors ray traced in the current frame before they are accumulated with the history. */
+    GLuint ray_tracing_color_texture = 0;
+    /** The depths ray traced in the current and the previous frame (they alternate, see @link history_index). */
+    GLuint ray_tracing_depth_textures[2] = {0, 0};
+    /** The colors accumulated in the current and the previous frame (they alternate, see @link history_index). */
+    GLuint history_color_textures[2] = {0, 0};
+
+    /** The positions of the rasterized surfaces in world space (see 'shaders/gbuffer.frag'). */
+    GLuint gbuffer_position_texture = 0;
+    /** The normals of the rasterized surfaces in world space. */
+    GLuint gbuffer_normal_texture = 0;
+    /** The indices of the materials of the rasterized surfaces, -1 where nothing is rasterized. */
+    GLuint gbuffer_material_texture = 0;
+    /** The depth used when rasterizing the G-buffer. */
+    GLuint gbuffer_depth_texture = 0;
+
+    /**
+     * The colors and the depth of the image ray traced at the scaled resolution. They have the size of the window and
+     * only their bottom-left part of the size @link render_width x @link render_height is used, hence they do not have
+     * to be reallocated when the scale changes.
+     */
+    GLuint scaled_color_texture = 0;
+    GLuint scaled_depth_texture = 0;
+
+    /**
+     * The colors, the normals and the depths of the primary hits of the interleaved rendering. They are never cleared,
+     * every pixel keeps the values from the last frame in which it was traced.
+     */
+    GLuint interleaved_color_texture = 0;
+    GLuint interleaved_normal_texture = 0;
+    GLuint interleaved_depth_texture = 0;
+
 protected:
     // ----------------------------------------------------------------------------
     // Variables (Light)
@@ -46,25 +127,130 @@ protected:
 protected:
     /** The UBO storing the data about lights - positions, colors, etc. */
     PhongLightsUBO phong_lights_ubo;
+    /** The buffer with the rectangular area lights. */
+    UBO<RectangularLightData> rectangular_lights_ssbo;
     // ----------------------------------------------------------------------------
     // Variables (Camera)
     // ----------------------------------------------------------------------------
 protected:
     /** The UBO storing the information about camera. */
     CameraUBO camera_ubo;
+    /** The camera rasterizing the G-buffer, its projection matches the primary rays generated in 'shaders/ray_tracing.frag'. */
+    CameraUBO gbuffer_camera_ubo;
     // ----------------------------------------------------------------------------
     // Variables (Shaders)
     // ----------------------------------------------------------------------------
 
     ShaderProgram particle_textured_program;
 
+    /** The program drawing the particles as quads without the geometry shader (the vertices pull the particles). */
+    ShaderProgram particle_quad_program;
+
+    /** The program placing the particles at random positions. */
+    ShaderProgram snow_seed_program;
+
+    /** The program advancing the particles by one time step. */
+    ShaderProgram snow_simulate_program;
+
+    /** The program culling the particles outside the frustum or behind the scene. */
+    ShaderProgram snow_cull_program;
+
     ShaderProgram ray_tracing_program;
 
+    /** The program displaying the image computed by the CPU ray tracer. */
+    ShaderProgram display_cpu_program;
+
+    /** The program blending the ray traced frame with the reprojected history. */
+    ShaderProgram temporal_accumulation_program;
+
+    /** The program filling the pixels that are not traced in the current frame of the interleaved rendering. */
+    ShaderProgram interleaved_reconstruction_program;
+
+    /** The program rasterizing the positions, normals and materials of the spheres and the floor into the G-buffer. */
+    ShaderProgram gbuffer_program;
+
+    /** The programs of the stages of the wavefront ray tracing (see 'shaders/wavefront.glsl'). */
+    ShaderProgram wavefront_generate_program;
+    ShaderProgram wavefront_intersect_program;
+    ShaderProgram wavefront_shade_program;
+    ShaderProgram wavefront_advance_program;
+    ShaderProgram wavefront_shadow_program;
+
+    /** The program writing the colors and the depths computed by the wavefront ray tracing into the framebuffer. */
+    ShaderProgram wavefront_resolve_program;
+
+    // ----------------------------------------------------------------------------
+    // Variables (CPU Ray Tracing)
+    // ----------------------------------------------------------------------------
+protected:
+    /** The CPU implementation of the ray tracer. */
+    CPURayTracer cpu_ray_tracer;
+
+    // ----------------------------------------------------------------------------
+    // Variables (Temporal Accumulation)
+    // ----------------------------------------------------------------------------
+protected:
+    /** The index of the textures and framebuffers written in the current frame, the others hold the previous frame. */
+    int history_index = 0;
+
+    /** The flag determining if the textures of the previous frame hold a valid history. */
+    bool history_valid = false;
+
+    /** The view matrix of the previous frame used to reproject the history. */
+    glm::mat4 previous_view = glm::mat4(1.0f);
+
+    /** The index of the ray traced frame offsetting the shadow samples (zero without the temporal accumulation). */
+    int frame_index = 0;
+
+    // ----------------------------------------------------------------------------
+    // Variables (Dynamic Resolution)
+    // ----------------------------------------------------------------------------
+protected:
+    /** The ratio of the resolution of the ray tracing and of the window, it is adjusted by @link update_render_resolution. */
+    float resolution_scale = 1.0f;
+
+    /** The width of the ray traced image (in pixels). */
+    int render_width = 1;
+
+    /** The height of the ray traced image (in pixels). */
+    int render_height = 1;
+
+    // ----------------------------------------------------------------------------
+    // Variables (Interleaved Rendering)
+    // ----------------------------------------------------------------------------
+protected:
+    /** The index of the current frame in the period of the interleaved rendering (see 'shaders/interleaving.glsl'). */
+    int interleaving_phase = 0;
+
+    /** The flag determining if all pixels of the interleaved textures were traced at the current resolution. */
+    bool interleaved_history_valid = false;
+
+    /** The resolution at which the interleaved textures were traced. */
+    glm::ivec2 interleaved_resolution = glm::ivec2(0);
+
 protected:
     // ----------------------------------------------------------------------------
     // Variables (Frame Buffers)
     // ----------------------------------------------------------------------------
 protected:
+    /** The framebuffer into which the depth of the scene is copied (see @link scene_depth_texture). */
+    GLuint scene_depth_framebuffer = 0;
+
+    /** The framebuffers into which the ray tracer renders the frames that are accumulated (one per depth texture). */
+    GLuint ray_tracing_framebuffers[2] = {0, 0};
+
+    /** The framebuffers into which the accumulated colors are written (one per history texture). */
+    GLuint history_framebuffers[2] = {0, 0};
+
+    /** The framebuffer with the G-buffer textures. */
+    GLuint gbuffer_framebuffer = 0;
+
+    /** The framebuffer into which the ray tracer renders the scaled image that is then upscaled to the window. */
+    GLuint scaled_framebuffer = 0;
+
+    /** The framebuffer into which the ray tracer renders the pixels traced in the current frame of the interleaved rendering. */
+    GLuint interleaved_framebuffer = 0;
+
     // ----------------------------------------------------------------------------
     // Variables (GUI)
     // ----------------------------------------------------------------------------
@@ -72,7 +258,7 @@ protected:
     /** The number of iterations. */
     int reflections = 3;
 
-    const int max_snow_count = 131072;
+    const int max_snow_count = 4194304;
 
     /** The desired snow particle count. */
     int desired_snow_count = 4096;
@@ -80,25 +266,91 @@ protected:
     /** The current snow particle count. */
     int current_snow_count = 256;
 
+    /** The desired number of snowmen. */
+    int desired_snowman_count = 1;
+
+    /** The current number of snowmen. */
+    int current_snowman_count = 1;
+
+    /** The distance at which the spheres stop contributing to the ambient occlusion. */
+    float occlusion_distance = 20.0f;
+
     /** The flag determining if a snow should be visible. */
     bool show_snow = true;
 
+    /** The velocity of the wind moving the snow (in units per second). */
+    glm::vec3 wind = glm::vec3(0.6f, 0.0f, 0.3f);
+
+    /** The strength of the turbulence swirling the snow (in units per second). */
+    float turbulence = 0.4f;
+
+    /** The flag determining if the snow particles outside the frustum or behind the scene should be culled. */
+    bool cull_snow = true;
+
+    /** The flag determining if the snow quads should be built by the vertex shader instead of the geometry shader. */
+    bool use_snow_vertex_pulling = true;
+
     /** The flag determining if the ambient occlusion should be used. */
     bool use_ambient_occlusion = true;
 
     bool use_raytracing = true;
 
+    /** The flag determining if the primary visibility should be rasterized and only the secondary rays traced. */
+    bool use_hybrid_rendering = false;
+
+    /** The flag determining if the ray tracing should be computed on CPU instead of GPU. */
+    bool use_cpu_raytracing = false;
+
+    /** The flag determining if the GPU ray tracing should run in the stages of the wavefront ray tracing (compute shaders). */
+    bool use_wavefront_raytracing = false;
+
+    /** The flag requesting a comparison of the GPU image with the CPU reference in the next frame. */
+    bool compare_with_cpu = false;
+
+    /** The largest channel difference that is not considered a mismatch when comparing with the CPU reference. */
+    float compare_tolerance = 0.02f;
+
     /** The number of shadow samples. */
     int shadow_samples = 16;
 
+    /** The flag determining if the shadows of the spherical lights should be computed analytically instead of by shadow rays. */
+    bool use_analytic_shadows = false;
+
+    /** The flag determining if the reflected rays should stop when their contribution is not visible. */
+    bool use_throughput_cutoff = false;
+
+    /** The flag determining if the reflected rays with a low contribution should be randomly terminated. */
+    bool use_russian_roulette = false;
+
+    /** The flag determining if only the hits in the penumbra (detected by a few probe rays) should get all shadow samples. */
+    bool use_adaptive_shadows = false;
+
+    /** The flag determining if the ray traced frames should be accumulated over time (with fewer shadow samples per frame). */
+    bool use_temporal_accumulation = false;
+
+    /** The weight of the history when accumulating the frames; the higher weight gives less noise but more lag. */
+    float history_weight = 0.95f;
+
+    /** The flag determining if the resolution of the ray tracing should be adjusted to hold the target frame time. */
+    bool use_dynamic_resolution = false;
+
+    /** The GPU frame time held by the dynamic resolution (in milliseconds). */
+    float target_frame_time = 16.7f;
+
+    /** The number of frames in which every pixel is traced once: 1 traces all pixels, 2 a checkerboard, 4 a quarter. */
+    int interleaving_period = 1;
+
     /** The flag determining if an area light should be present. */
     float sphere_light_radius = 0.5f;
 
     /** The flag determining if a blue noise should be used when sampling the spherical lights. */
-    bool corrective_smooth_shadows = false;
+    bool use_blue_noise_shadows = false;
 
     /** The flag determining if an rectangular area light should be used. */
-    bool corrective_rectangular_area_light = false;
+    bool use_rectangular_light = false;
+
+    /** The radiance emitted by the rectangular light. */
+    float rectangular_light_intensity = 8.0f;
 
     
 
@@ -141,9 +393,15 @@ public:
     /** Prepares the lights. */
     void prepare_lights();
 
+    /** Updates the radiance of the rectangular lights in their buffer to the current intensity. */
+    void update_rectangular_lights();
+
     /** Builds a snowman from individual parts. */
     void prepare_snowman();
 
+    /** Instantiates the snowman into a field of @link current_snowman_count snowmen and uploads it into the buffers. */
+    void prepare_snowman_field();
+
     /** Prepares the scene objects. */
     void prepare_scene();
 
@@ -153,8 +411,29 @@ public:
     /** Resizes the full screen textures match the window. */
     void resize_fullscreen_textures();
 
+    /** Seeds all @link current_snow_count particles on GPU; the particles are always at the same places after the reset. */
     void reset_particles();
 
+    /**
+     * Seeds the particles in the specified range on GPU.
+     *
+     * @param 	first	The index of the first seeded particle.
+     * @param 	count	The number of seeded particles.
+     */
+    void seed_particles(int first, int count);
+
+    /** Creates the buffer with the instances for the current snowman field. */
+    void prepare_instances();
+
+    /** Uploads the model matrices of the lights into the instance buffer. */
+    void update_light_instances();
+
+    /** Binds the shader storage buffers with the spheres, their materials, and the BVH. */
+    void bind_spheres();
+
+    /** Builds the BVH over the spheres of the snowman field and uploads it into the shader storage buffers. */
+    void build_bvh();
+
     // ----------------------------------------------------------------------------
     // Update
     // ----------------------------------------------------------------------------
@@ -163,6 +442,13 @@ public:
      */
     void update(float delta) override;
 
+    /**
+     * Advances the snow simulation on GPU.
+     *
+     * @param 	delta	The time step (in milliseconds).
+     */
+    void simulate_particles(float delta);
+
     // ----------------------------------------------------------------------------
     // Render
     // ----------------------------------------------------------------------------
@@ -172,6 +458,49 @@ public:
 
     void raytrace_snowman();
 
+    /**
+     * Adjusts the scale of the resolution of the ray tracing so that the measured GPU frame time approaches the target
+     * one (or resets it if the dynamic resolution is disabled) and updates the resolution of the ray traced image.
+     */
+    void update_render_resolution();
+
+    /**
+     * Sets the uniforms of the ray tracing (see 'shaders/ray_tracing.glsl') to the program.
+     *
+     * @param 	program	The program with the ray tracing.
+     */
+    void set_ray_tracing_uniforms(const ShaderProgram& program);
+
+    /** Traces all pixels tile by tile in the stages of the wavefront ray tracing, the results are in the wavefront buffers. */
+    void trace_wavefront();
+
+    /** Rasterizes the spheres and the floor into the G-buffer from which the ray tracing starts in the hybrid rendering. */
+    void render_gbuffer();
+
+    /** Renders the snowman using the CPU ray tracer and displays the result. */
+    void raytrace_snowman_cpu();
+
+    /**
+     * Fills the pixels that are not traced in the current frame of the interleaved rendering from their traced neighbors
+     * and from their colors traced in the previous frames, and writes the colors and depths into the bound framebuffer.
+     */
+    void reconstruct_interleaved_frame();
+
+    /** Blends the ray traced frame with the reprojected history and copies the result into the output framebuffer. */
+    void accumulate_frame();
+
+    /** Reads the ray traced image from the frame buffer and compares it with the CPU reference. */
+    void compare_with_cpu_reference();
+
+    /** Returns the rectangular lights that are used (none if they are disabled in the GUI). */
+    std::vector<RectangularLightData> get_rectangular_lights();
+
+    /** Returns the settings for the CPU ray tracer corresponding to the current GUI values. */
+    CPURayTracerSettings get_cpu_ray_tracer_settings() const;
+
+    /** Culls the snow particles against the frustum and the depth of the scene and prepares the indirect draw command. */
+    void cull_particles();
+
     void render_snow();
 
     /** Renders the snowman using rasterization. */
@@ -0,0 +1,80 @@
+#include "ray_packet.hpp"
+#include "utils/utils.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Micro-benchmark of the CPU ray tracing kernels.
+// It measures how many rays per second the packet kernels intersect with a scene of the size of the snowman.
+// ----------------------------------------------------------------------------
+
+/** Creates packets of coherent rays (a pinhole camera looking at the origin), or shadow bundles towards one light. */
+std::vector<RayPacket> create_packets(bool shadow_bundles, int packet_count) {
+    std::vector<RayPacket> packets(packet_count);
+    const int columns = 64;
+    for (int p = 0; p < packet_count; p++) {
+        for (int i = 0; i < packet_size; i++) {
+            const float u = (static_cast<float>((p % columns) * packet_size + i) / (columns * packet_size)) * 2.0f - 1.0f;
+            const float v = (static_cast<float>(p / columns) / (packet_count / columns)) * 2.0f - 1.0f;
+            if (shadow_bundles) {
+                // All rays start at one point on the ground and point to a disk around the light.
+                const glm::vec3 origin(2.0f, 0.01f, 2.0f);
+                const glm::vec3 light(-4.0f, 6.0f, -4.0f);
+                packets[p].set_ray(i, origin, glm::normalize(light + 0.5f * glm::vec3(u, v, 0.0f) - origin));
+            } else {
+                const glm::vec3 origin(0.0f, 5.0f, 25.0f);
+                packets[p].set_ray(i, origin, glm::normalize(glm::vec3(u * 1.7f, v, -2.4f)));
+            }
+        }
+    }
+    return packets;
+}
+
+/** Intersects all packets repeatedly and returns the number of rays per second. */
+double measure(const PacketIntersector& intersector, const SphereSoA& spheres, const std::vector<RayPacket>& input, int repetitions) {
+    std::vector<RayPacket> packets = input;
+    long long checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        for (RayPacket& packet : packets) {
+            intersector.intersect_ground(packet);
+            intersector.intersect_spheres(spheres, packet);
+            checksum += packet.object[r % packet_size];
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    // Prevents the compiler from removing the loop.
+    BenchmarkUtils::do_not_optimize(checksum);
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    return static_cast<double>(packets.size()) * packet_size * repetitions / seconds;
+}
+
+int main(int argc, char** argv) {
+    const int repetitions = argc > 1 ? std::stoi(argv[1]) : 200;
+    const int packet_count = 64 * 64;
+
+    // A scene with the same number of spheres as the snowman.
+    SphereSoA spheres;
+    for (int i = 0; i < 13; i++) {
+        spheres.add(glm::vec3(0.4f * (i % 3) - 0.4f, 1.2f + 0.35f * i, 0.3f * (i % 2)), i < 5 ? 1.0f : 0.15f);
+    }
+
+    const std::vector<RayPacket> primary = create_packets(false, packet_count);
+    const std::vector<RayPacket> shadow = create_packets(true, packet_count);
+
+    std::cout << "Best supported ISA: " << PacketIntersector::get_isa_name(PacketIntersector::detect_isa()) << std::endl;
+    for (SimdIsa isa : {SimdIsa::Scalar, SimdIsa::SSE, SimdIsa::AVX2}) {
+        if (!PacketIntersector::is_supported(isa)) {
+            std::cout << PacketIntersector::get_isa_name(isa) << ": not supported" << std::endl;
+            continue;
+        }
+        const PacketIntersector intersector(isa);
+        std::cout << PacketIntersector::get_isa_name(isa) << ": primary " << measure(intersector, spheres, primary, repetitions) / 1e6 << " Mrays/s, shadow "
+                  << measure(intersector, spheres, shadow, repetitions) / 1e6 << " Mrays/s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,773 @@
+#include "cpu_ray_tracer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/** The intersection distance of a miss. */
+const float miss_t = 1e20f;
+
+/** The offset of secondary rays, the same as in the shader. */
+const float epsilon = 1e-2f;
+
+const float PI = 3.14159265359f;
+
+/** The number of probe rays classifying the hits in the adaptive shadows, the same as in the shader. */
+const int shadow_probe_count = 5;
+
+/** The radius of the rim probes relative to the radius of the light, the same as in the shader. */
+const float shadow_probe_radius = 0.95f;
+
+/** The throughput below which the path is stopped by the cutoff, the same as in the shader. */
+const float min_throughput = 1e-3f;
+
+/** The throughput below which the paths enter the Russian roulette, the same as in the shader. */
+const float russian_roulette_throughput = 0.1f;
+
+/** The FresnelSchlick approximation of the reflection. */
+glm::vec3 fresnel_schlick(const glm::vec3& f0, const glm::vec3& V, const glm::vec3& H) {
+    const float VdotH = glm::clamp(glm::dot(V, H), 0.0f, 1.0f);
+    return f0 + (1.0f - f0) * std::pow(1.0f - VdotH, 5.0f);
+}
+
+/** The same hash function as hash23 in the shader. */
+glm::vec2 hash23(glm::vec3 p3) {
+    p3 = glm::fract(p3 * glm::vec3(.1031f, .1030f, .0973f));
+    p3 += glm::dot(p3, glm::vec3(p3.y, p3.z, p3.x) + 33.33f);
+    return glm::fract((glm::vec2(p3.x, p3.x) + glm::vec2(p3.y, p3.z)) * glm::vec2(p3.z, p3.y));
+}
+
+/** Returns the direction towards a point of the spherical light (the same as LightDiskDirection in the shader). */
+glm::vec3 light_disk_direction(const glm::vec3& L, const glm::vec2& point_on_disk) {
+    const glm::vec3 light_tangent = glm::normalize(glm::cross(L, glm::vec3(0.0f, -1.0f, 0.0f)));
+    const glm::vec3 light_bitangent = glm::normalize(glm::cross(light_tangent, L));
+
+    return glm::normalize(L + point_on_disk.x * light_tangent + point_on_disk.y * light_bitangent);
+}
+
+/** Checks if a ray intersects a box closer than max_t (the same as RayBoxIntersection in the shader). */
+bool ray_box_intersection(const glm::vec3& origin, const glm::vec3& inv_direction, const glm::vec3& bounds_min, const glm::vec3& bounds_max, float max_t) {
+    const glm::vec3 t1 = (bounds_min - origin) * inv_direction;
+    const glm::vec3 t2 = (bounds_max - origin) * inv_direction;
+    const glm::vec3 t_min = glm::min(t1, t2);
+    const glm::vec3 t_max = glm::max(t1, t2);
+    const float t_near = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+    const float t_far = std::min(std::min(t_max.x, t_max.y), t_max.z);
+    return t_near <= t_far && t_near < max_t;
+}
+
+/** The occlusion of a single sphere, taken from https://www.shadertoy.com/view/4djSDy (same as sphere_occlusion in the shader). */
+float sphere_occlusion(const glm::vec3& position, const glm::vec3& normal, const glm::vec4& sphere, float occlusion_distance) {
+    const glm::vec3 di = glm::vec3(sphere) - position;
+    const float l = glm::length(di);
+    const float nl = glm::dot(normal, di / l);
+    const float h = l / sphere.w;
+    const float h2 = h * h;
+    const float k2 = 1.0f - h2 * nl * nl;
+
+    // above or below the hemisphere
+    float res = std::max(0.0f, nl) / h2;
+
+    // intersecting the hemisphere
+    if (k2 > 0.0f) {
+        res = (nl * h + 1.0f) / h2;
+        res = 0.33f * res * res;
+    }
+
+    // The contribution fades out towards the occlusion distance, hence the spheres behind it can be skipped without seams.
+    return res * (1.0f - glm::smoothstep(0.5f * occlusion_distance, occlusion_distance, l));
+}
+
+/** The fraction of the cap of the light covered by the cap of an occluder (same as cap_coverage in the shader). */
+float cap_coverage(float light_angle, float occluder_angle, float angle_between) {
+    const float delta = std::abs(light_angle - occluder_angle);
+    if (angle_between >= light_angle + occluder_angle) {
+        return 0.0f;
+    }
+
+    const float smaller = light_angle <= occluder_angle ? 1.0f : (1.0f - std::cos(occluder_angle)) / std::max(1.0f - std::cos(light_angle), 1e-7f);
+    if (angle_between <= delta) {
+        return smaller;
+    }
+    return smaller * glm::smoothstep(0.0f, 1.0f, 1.0f - (angle_between - delta) / (light_angle + occluder_angle - delta));
+}
+
+/** Integrates the clamped cosine over a spherical edge (the same as ltc_integrate_edge in the shader). */
+glm::vec3 ltc_integrate_edge(const glm::vec3& v1, const glm::vec3& v2) {
+    const float x = glm::dot(v1, v2);
+    const float y = std::abs(x);
+    const float a = 0.8543985f + (0.4965155f + 0.0145206f * y) * y;
+    const float b = 3.4175940f + (4.1616724f + y) * y;
+    const float v = a / b;
+    const float theta_sin_theta = (x > 0.0f) ? v : 0.5f / std::sqrt(std::max(1.0f - x * x, 1e-7f)) - v;
+    return glm::cross(v1, v2) * theta_sin_theta;
+}
+
+/** Clips the quad to the upper hemisphere and returns the number of remaining vertices (see ltc_clip_quad_to_horizon in the shader). */
+int ltc_clip_quad_to_horizon(glm::vec3 L[5]) {
+    const int config = (L[0].z > 0.0f ? 1 : 0) + (L[1].z > 0.0f ? 2 : 0) + (L[2].z > 0.0f ? 4 : 0) + (L[3].z > 0.0f ? 8 : 0);
+    // The intersection of the edge between a and b with the horizon (not normalized).
+    const auto clip = [](const glm::vec3& a, const glm::vec3& b) { return -b.z * a + a.z * b; };
+
+    int n = 0;
+    switch (config) {
+    case 1: n = 3; L[1] = clip(L[0], L[1]); L[2] = clip(L[0], L[3]); break;
+    case 2: n = 3; L[0] = clip(L[1], L[0]); L[2] = clip(L[1], L[2]); break;
+    case 3: n = 4; L[2] = clip(L[1], L[2]); L[3] = clip(L[0], L[3]); break;
+    case 4: n = 3; L[0] = clip(L[2], L[3]); L[1] = clip(L[2], L[1]); break;
+    case 6: n = 4; L[0] = clip(L[1], L[0]); L[3] = clip(L[2], L[3]); break;
+    case 7: n = 5; L[4] = clip(L[0], L[3]); L[3] = clip(L[2], L[3]); break;
+    case 8: n = 3; L[0] = clip(L[3], L[0]); L[1] = clip(L[3], L[2]); L[2] = L[3]; break;
+    case 9: n = 4; L[1] = clip(L[0], L[1]); L[2] = clip(L[3], L[2]); break;
+    case 11: n = 5; L[4] = L[3]; L[3] = clip(L[3], L[2]); L[2] = clip(L[1], L[2]); break;
+    case 12: n = 4; L[1] = clip(L[2], L[1]); L[0] = clip(L[3], L[0]); break;
+    case 13: n = 5; L[4] = L[3]; L[3] = L[2]; L[2] = clip(L[2], L[1]); L[1] = clip(L[0], L[1]); break;
+    case 14: n = 5; L[4] = clip(L[3], L[0]); L[0] = clip(L[1], L[0]); break;
+    case 15: n = 4; break;
+    default: break;
+    }
+
+    // Closes the polygon.
+    if (n == 3) L[3] = L[0];
+    if (n == 4) L[4] = L[0];
+    return n;
+}
+
+/** Integrates the LTC distribution over the quad seen from the position (the same as ltc_evaluate in the shader). */
+float ltc_evaluate(const glm::vec3& position, const glm::vec3& normal, glm::mat3 Minv, const glm::vec3 points[4]) {
+    const glm::vec3 T1 = glm::normalize(glm::cross(normal, std::abs(normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f)));
+    const glm::vec3 T2 = glm::cross(normal, T1);
+    Minv = Minv * glm::transpose(glm::mat3(T1, T2, normal));
+
+    glm::vec3 L[5];
+    for (int i = 0; i < 4; i++) {
+        L[i] = Minv * (points[i] - position);
+    }
+    L[4] = L[3];
+
+    const int n = ltc_clip_quad_to_horizon(L);
+    if (n == 0) {
+        return 0.0f;
+    }
+
+    for (glm::vec3& l : L) {
+        l = glm::normalize(l);
+    }
+    glm::vec3 sum = ltc_integrate_edge(L[0], L[1]) + ltc_integrate_edge(L[1], L[2]) + ltc_integrate_edge(L[2], L[3]);
+    if (n >= 4) sum += ltc_integrate_edge(L[3], L[4]);
+    if (n == 5) sum += ltc_integrate_edge(L[4], L[0]);
+    return std::abs(sum.z);
+}
+
+/** The form factor of the rectangular light at the position (the same as rectangular_light_form_factor in the shader). */
+float rectangular_light_form_factor(const RectangularLightData& light, const glm::vec3& position, const glm::vec3& normal) {
+    const glm::vec3 center(light.center);
+    const glm::vec3 u(light.half_u);
+    const glm::vec3 v(light.half_v);
+    if (glm::dot(position - center, glm::cross(u, v)) <= 0.0f) {
+        return 0.0f;
+    }
+
+    const glm::vec3 points[4] = {center - u - v, center + u - v, center + u + v, center - u + v};
+    return ltc_evaluate(position, normal, glm::mat3(1.0f), points);
+}
+
+/** The point of the rectangular light at the coordinates from [0,1]^2 (the same as rectangular_light_point in the shader). */
+glm::vec3 rectangular_light_point(const RectangularLightData& light, const glm::vec2& uv) {
+    return glm::vec3(light.center) + (2.0f * uv.x - 1.0f) * glm::vec3(light.half_u) + (2.0f * uv.y - 1.0f) * glm::vec3(light.half_v);
+}
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+CPURayTracer::CPURayTracer(unsigned int thread_count) : scheduler(thread_count) {}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void CPURayTracer::set_scene(const SnowmanField& field) {
+    this->field = field;
+
+    // Prepares the spheres for the packet kernels.
+    bvh.build(field.spheres.data(), field.size());
+    scene_spheres.clear();
+    for (int i : bvh.get_indices()) {
+        scene_spheres.add(glm::vec3(field.spheres[i]), field.spheres[i].w);
+    }
+}
+
+void CPURayTracer::render(const std::vector<PhongLightData>& lights, const std::vector<RectangularLightData>& rectangular_lights, const CameraData& camera,
+                          const CPURayTracerSettings& settings, int width, int height) {
+    this->lights = lights;
+    this->rectangular_lights = rectangular_lights;
+    this->camera = camera;
+    this->settings = settings;
+    this->width = width;
+    this->height = height;
+
+    // Prepares the lights for the packet kernels.
+    light_spheres.clear();
+    for (const PhongLightData& light : lights) {
+        light_spheres.add(glm::vec3(light.position) / light.position.w, settings.sphere_light_radius + epsilon);
+    }
+
+    color.resize(static_cast<size_t>(width) * height);
+    depth.resize(static_cast<size_t>(width) * height);
+
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    const int tiles_y = (height + tile_size - 1) / tile_size;
+    scheduler.run(tiles_x * tiles_y, [this](int tile) { render_tile(tile); });
+}
+
+ImageComparison CPURayTracer::compare(const std::vector<glm::vec4>& reference, const std::vector<glm::vec4>& image, float tolerance) {
+    ImageComparison result;
+    const size_t count = std::min(reference.size(), image.size());
+    if (count == 0) {
+        return result;
+    }
+
+    double squared_sum = 0.0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3 a = glm::clamp(glm::vec3(reference[i]), 0.0f, 1.0f);
+        const glm::vec3 b = glm::clamp(glm::vec3(image[i]), 0.0f, 1.0f);
+        const glm::vec3 difference = glm::abs(a - b);
+        const float pixel_error = std::max(difference.x, std::max(difference.y, difference.z));
+
+        squared_sum += glm::dot(difference, difference);
+        result.max_error = std::max(result.max_error, pixel_error);
+        if (pixel_error > tolerance) {
+            mismatches++;
+        }
+    }
+    result.rmse = static_cast<float>(std::sqrt(squared_sum / (3.0 * count)));
+    result.mismatch_ratio = static_cast<float>(mismatches) / static_cast<float>(count);
+    return result;
+}
+
+void CPURayTracer::render_tile(int tile) {
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    const int x0 = (tile % tiles_x) * tile_size;
+    const int y0 = (tile / tiles_x) * tile_size;
+    const int x1 = std::min(x0 + tile_size, width);
+    const int y1 = std::min(y0 + tile_size, height);
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x += packet_size) {
+            const int count = std::min(packet_size, x1 - x);
+
+            Ray rays[packet_size];
+            RayPacket packet;
+            for (int i = 0; i < count; i++) {
+                rays[i] = primary_ray(x + i, y);
+                packet.set_ray(i, rays[i].origin, rays[i].direction);
+            }
+            packet.fill_unused(count);
+
+            // Finds the first hits in the same order as Evaluate: the ground, the spheres, and the lights.
+            evaluate_packet(packet);
+            intersector.intersect_spheres(light_spheres, packet, field.size());
+
+            for (int i = 0; i < count; i++) {
+                Hit hit = make_hit(rays[i], packet.t[i], packet.object[i]);
+                intersect_rectangles(rays[i], hit);
+
+                float pixel_depth;
+                const glm::vec3 pixel_color = trace(rays[i], hit, pixel_depth);
+                color[static_cast<size_t>(y) * width + x + i] = glm::vec4(pixel_color, 1.0f);
+                depth[static_cast<size_t>(y) * width + x + i] = pixel_depth;
+            }
+        }
+    }
+}
+
+CPURayTracer::Ray CPURayTracer::primary_ray(int x, int y) const {
+    // The aspect ratio.
+    const float aspect_ratio = static_cast<float>(width) / static_cast<float>(height);
+
+    // The texture coordinates the full screen triangle interpolates at the pixel center.
+    const glm::vec2 tex_coord((x + 0.5f) / width, (y + 0.5f) / height);
+    const glm::vec2 uv = (2.0f * tex_coord - 1.0f) * glm::vec2(aspect_ratio, 1.0f);
+
+    // Computes the ray origin and ray direction using the view matrix.
+    const glm::vec3 eye_position = glm::vec3(camera.eye_position);
+    const glm::vec3 P = glm::vec3(camera.view_inv * glm::vec4(uv, -1.0f, 1.0f));
+    const glm::vec3 direction = glm::normalize(P - eye_position);
+
+    return Ray{eye_position, direction, -1};
+}
+
+glm::vec3 CPURayTracer::trace(Ray ray, Hit hit, float& pixel_depth) const {
+    // The accumulated color and attenuation used when tracing the rays throug the scene.
+    glm::vec3 color(0.0f);
+    glm::vec3 attenuation(1.0f);
+    float occluded_ambient = 1.0f;
+    pixel_depth = 1.0f;
+
+    for (int i = 0; i < settings.iterations; ++i) {
+        // Handles depth and ambient occlusion in the first iteration, the first hit is computed by the caller.
+        if (i == 0) {
+            pixel_depth = compute_depth(hit, ray);
+
+            if (settings.use_ambient_occlusion) {
+                occluded_ambient = occlude_ambient(hit.intersection, hit.normal);
+            }
+        } else {
+            hit = evaluate(ray);
+        }
+
+        if (hit.t >= miss_t) {
+            break;
+        }
+
+        if (hit.light_index >= 0) {
+            color += hit.material.diffuse * attenuation;
+        }
+
+        const glm::vec3 fresnel = fresnel_schlick(hit.material.f0, hit.normal, -ray.direction);
+
+        color = compute_shadow_ray(hit, color, fresnel, attenuation);
+        color = compute_rectangular_lights(hit, color, fresnel, attenuation);
+
+        attenuation *= fresnel;
+
+        // Stops the paths whose remaining bounces cannot contribute visibly (see Trace in the shader).
+        const float throughput = std::max(attenuation.x, std::max(attenuation.y, attenuation.z));
+        if (settings.use_russian_roulette) {
+            const float survival = std::min(throughput / russian_roulette_throughput, 1.0f);
+            if (hash23(glm::vec3(hash23(hit.intersection), static_cast<float>(i + settings.frame_index * settings.iterations))).x >= survival) {
+                break;
+            }
+            attenuation /= survival;
+        } else if (settings.use_throughput_cutoff && throughput < min_throughput) {
+            break;
+        }
+
+        const glm::vec3 reflection = glm::reflect(ray.direction, hit.normal);
+        ray = Ray{hit.intersection + epsilon * reflection, reflection, -1};
+    }
+
+    return color * occluded_ambient;
+}
+
+CPURayTracer::Hit CPURayTracer::evaluate(const Ray& ray) const {
+    // Sets the closes hit either to miss or to an intersection with the plane representing the ground.
+    Hit closest_hit = ray_plane_intersection(ray, glm::vec3(0, 1, 0), glm::vec3(0));
+
+    // Traverses the hierarchy of the spheres, the nearer child is visited first.
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    const std::vector<int>& indices = bvh.get_indices();
+    const glm::vec3 inv_direction = 1.0f / ray.direction;
+    int stack[SphereBVH::max_depth];
+    int stack_size = 0;
+    int node_index = 0;
+    while (true) {
+        const BVHNode& node = nodes[node_index];
+        if (ray_box_intersection(ray.origin, inv_direction, node.bounds_min, node.bounds_max, closest_hit.t)) {
+            if (node.is_leaf()) {
+                for (int k = node.first; k < node.first + node.count; k++) {
+                    const int i = indices[k];
+                    const Hit intersection = ray_sphere_intersection(ray, glm::vec3(field.spheres[i]), field.spheres[i].w, i, true);
+                    if (intersection.t < closest_hit.t) {
+                        closest_hit = intersection;
+                    }
+                }
+            } else {
+                const bool negative = ray.direction[-1 - node.count] < 0.0f;
+                stack[stack_size++] = negative ? node_index + 1 : node.first;
+                node_index = negative ? node.first : node_index + 1;
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+
+    for (int i = 0; i < static_cast<int>(lights.size()); i++) {
+        if ((ray.light_mask & (1 << i)) == 0) {
+            continue;
+        }
+        const glm::vec3 center = glm::vec3(lights[i].position) / lights[i].position.w;
+        const Hit intersection = ray_sphere_intersection(ray, center, settings.sphere_light_radius + epsilon, i, false);
+        if (intersection.t < closest_hit.t) {
+            closest_hit = intersection;
+        }
+    }
+
+    intersect_rectangles(ray, closest_hit);
+    return closest_hit;
+}
+
+void CPURayTracer::evaluate_packet(RayPacket& packet) const {
+    intersector.intersect_ground(packet);
+
+    // The inverse directions for the box tests.
+    glm::vec3 inv_directions[packet_size];
+    for (int i = 0; i < packet_size; i++) {
+        inv_directions[i] = 1.0f / glm::vec3(packet.direction_x[i], packet.direction_y[i], packet.direction_z[i]);
+    }
+
+    // Traverses the hierarchy with the whole packet; a node is entered if any ray hits its box.
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    int stack[SphereBVH::max_depth];
+    int stack_size = 0;
+    int node_index = 0;
+    while (true) {
+        const BVHNode& node = nodes[node_index];
+        bool any_hit = false;
+        for (int i = 0; i < packet_size && !any_hit; i++) {
+            const glm::vec3 origin(packet.origin_x[i], packet.origin_y[i], packet.origin_z[i]);
+            any_hit = ray_box_intersection(origin, inv_directions[i], node.bounds_min, node.bounds_max, packet.t[i]);
+        }
+        if (any_hit) {
+            if (node.is_leaf()) {
+                // The leaves reference consecutive spheres since the spheres are stored in the BVH order.
+                intersector.intersect_spheres(scene_spheres, node.first, node.first + node.count, packet);
+            } else {
+                // The packets are coherent, hence the order is decided by the first ray.
+                const bool negative = inv_directions[0][-1 - node.count] < 0.0f;
+                stack[stack_size++] = negative ? node_index + 1 : node.first;
+                node_index = negative ? node.first : node_index + 1;
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+}
+
+CPURayTracer::Hit CPURayTracer::miss() {
+    return Hit{miss_t, glm::vec3(0.0f), glm::vec3(0.0f), PBRMaterialData(glm::vec3(0.0f), glm::vec3(0.0f), 0.0f), -1};
+}
+
+CPURayTracer::Hit CPURayTracer::make_hit(const Ray& ray, float t, int object) const {
+    if (object == RayPacket::miss) {
+        return miss();
+    }
+
+    const glm::vec3 intersection = ray.origin + t * ray.direction;
+    if (object == RayPacket::ground) {
+        return Hit{t, intersection, glm::vec3(0, 1, 0), field.materials[0], -1};
+    }
+    if (object < field.size()) {
+        const int i = bvh.get_indices()[object];
+        const glm::vec3 normal = glm::normalize(intersection - glm::vec3(field.spheres[i]));
+        return Hit{t, intersection, normal, field.materials[i], -1};
+    }
+
+    const int i = object - field.size();
+    const glm::vec3 normal = glm::normalize(intersection - glm::vec3(lights[i].position) / lights[i].position.w);
+    return Hit{t, intersection, normal, PBRMaterialData(lights[i].diffuse, glm::vec3(0.0f), 0.0f), i};
+}
+
+CPURayTracer::Hit CPURayTracer::ray_sphere_intersection(const Ray& ray, const glm::vec3& center, float radius, int i, bool is_snowman) const {
+    const glm::vec3 oc = ray.origin - center;
+    const float b = glm::dot(ray.direction, oc);
+    const float c = glm::dot(oc, oc) - (radius * radius);
+
+    const float det = b * b - c;
+    if (det < 0.0f) return miss();
+
+    float t = -b - std::sqrt(det);
+    if (t < 0.0f) t = -b + std::sqrt(det);
+    if (t < 0.0f) return miss();
+
+    const glm::vec3 intersection = ray.origin + t * ray.direction;
+    const glm::vec3 normal = glm::normalize(intersection - center);
+    if (is_snowman) {
+        return Hit{t, intersection, normal, field.materials[i], -1};
+    } else {
+        return Hit{t, intersection, normal, PBRMaterialData(lights[i].diffuse, glm::vec3(0.0f), 0.0f), i};
+    }
+}
+
+CPURayTracer::Hit CPURayTracer::ray_rectangle_intersection(const Ray& ray, int r) const {
+    const RectangularLightData& light = rectangular_lights[r];
+    const glm::vec3 u(light.half_u);
+    const glm::vec3 v(light.half_v);
+    const glm::vec3 normal = glm::normalize(glm::cross(u, v));
+    const float nd = glm::dot(normal, ray.direction);
+    if (nd >= 0.0f) return miss();
+
+    const float t = glm::dot(glm::vec3(light.center) - ray.origin, normal) / nd;
+    if (t < 0.0f) return miss();
+
+    const glm::vec3 intersection = ray.origin + t * ray.direction;
+    const glm::vec3 offset = intersection - glm::vec3(light.center);
+    if (std::abs(glm::dot(offset, u)) > glm::dot(u, u) || std::abs(glm::dot(offset, v)) > glm::dot(v, v)) return miss();
+
+    return Hit{t, intersection, normal, PBRMaterialData(glm::vec3(light.radiance), glm::vec3(0.0f), 0.0f), static_cast<int>(lights.size()) + r};
+}
+
+void CPURayTracer::intersect_rectangles(const Ray& ray, Hit& closest_hit) const {
+    // The rectangular lights are seen only by the primary and the reflected rays, they do not cast shadows.
+    if (ray.light_mask != -1) {
+        return;
+    }
+    for (int r = 0; r < static_cast<int>(rectangular_lights.size()); r++) {
+        const Hit intersection = ray_rectangle_intersection(ray, r);
+        if (intersection.t < closest_hit.t) {
+            closest_hit = intersection;
+        }
+    }
+}
+
+CPURayTracer::Hit CPURayTracer::ray_plane_intersection(const Ray& ray, const glm::vec3& normal, const glm::vec3& point) const {
+    const float nd = glm::dot(normal, ray.direction);
+    const glm::vec3 sp = point - ray.origin;
+    const float t = glm::dot(sp, normal) / nd;
+    if (t < 0.0f) return miss();
+
+    const glm::vec3 intersection = ray.origin + t * ray.direction;
+
+    if (intersection.x > 100 || intersection.x < -100 || intersection.z > 100 || intersection.z < -100)
+        return miss();
+
+    return Hit{t, intersection, normal, field.materials[0], -1};
+}
+
+glm::vec3 CPURayTracer::compute_shadow_ray(const Hit& hit, glm::vec3 color, const glm::vec3& fresnel, const glm::vec3& attenuation) const {
+    const int lights_count = static_cast<int>(lights.size());
+    if (settings.use_analytic_shadows) {
+        for (int i = 0; i < lights_count; ++i) {
+            const glm::vec3 light_center = glm::vec3(lights[i].position) / lights[i].position.w;
+            const glm::vec3 L = glm::normalize(light_center - hit.intersection);
+            const float visibility = sphere_light_visibility(hit.intersection, light_center);
+            color += std::max(glm::dot(hit.normal, L), 0.0f) * lights[i].diffuse * hit.material.diffuse * (1.0f - fresnel) * attenuation * visibility /
+                     static_cast<float>(lights_count);
+        }
+        return color;
+    }
+
+    for (int i = 0; i < lights_count; ++i) {
+        const glm::vec3 light_center = glm::vec3(lights[i].position) / lights[i].position.w;
+
+        // Classifies the hit by the probe rays towards the center and the rim of the light (see ComputeShadowRay).
+        if (settings.use_adaptive_shadows && settings.shadow_samples > shadow_probe_count) {
+            glm::vec3 L = light_center - hit.intersection;
+            const float light_radius = settings.sphere_light_radius / glm::length(L);
+            const float rotation = hash23(L).x * 2 * PI;
+            L = glm::normalize(L);
+
+            Ray probes[shadow_probe_count];
+            RayPacket packet;
+            for (int p = 0; p < shadow_probe_count; p++) {
+                const float angle = rotation + static_cast<float>(p) * 2 * PI / static_cast<float>(shadow_probe_count - 1);
+                const glm::vec2 point_on_disk = p == 0 ? glm::vec2(0.0f) : shadow_probe_radius * light_radius * glm::vec2(std::cos(angle), std::sin(angle));
+                const glm::vec3 ray_dir = light_disk_direction(L, point_on_disk);
+                probes[p] = Ray{hit.intersection + epsilon * ray_dir, ray_dir, 1 << i};
+                packet.set_ray(p, probes[p].origin, probes[p].direction);
+            }
+            packet.fill_unused(shadow_probe_count);
+            evaluate_packet(packet);
+
+            int visible_probes = 0;
+            float lit = 0.0f;
+            for (int p = 0; p < shadow_probe_count; p++) {
+                const Hit light_hit = ray_sphere_intersection(probes[p], light_center, settings.sphere_light_radius + epsilon, i, false);
+                if (light_hit.t < packet.t[p]) {
+                    visible_probes++;
+                    lit += std::max(glm::dot(hit.normal, probes[p].direction), 0.0f);
+                }
+            }
+
+            if (visible_probes == 0) {
+                continue;
+            }
+            if (visible_probes == shadow_probe_count) {
+                color += lit / static_cast<float>(shadow_probe_count) * lights[i].diffuse * hit.material.diffuse * (1.0f - fresnel) * attenuation /
+                         static_cast<float>(lights_count);
+                continue;
+            }
+        }
+
+        // The samples towards one light start at the same point and are almost parallel, hence they are traced in packets.
+        for (int first = 0; first < settings.shadow_samples; first += packet_size) {
+            const int count = std::min(packet_size, settings.shadow_samples - first);
+
+            Ray shadow_rays[packet_size];
+            RayPacket packet;
+            for (int k = 0; k < count; k++) {
+                glm::vec3 L = light_center - hit.intersection;
+
+                const glm::vec2 hash = hash23(glm::vec3(hash23(L), static_cast<float>(first + k + settings.frame_index * settings.shadow_samples)));
+
+                const float light_radius = settings.sphere_light_radius / glm::length(L);
+
+                const float radius = std::sqrt(hash.x) * light_radius;
+                const float angle = hash.y * 2 * PI;
+
+                const glm::vec2 point_on_disk(radius * std::cos(angle), radius * std::sin(angle));
+
+                const glm::vec3 ray_dir = light_disk_direction(glm::normalize(L), point_on_disk);
+
+                shadow_rays[k] = Ray{hit.intersection + epsilon * ray_dir, ray_dir, 1 << i};
+                packet.set_ray(k, shadow_rays[k].origin, shadow_rays[k].direction);
+            }
+            packet.fill_unused(count);
+
+            // The occluders: the ground and the spheres.
+            evaluate_packet(packet);
+
+            for (int k = 0; k < count; k++) {
+                // The light is hit only if it is closer than all occluders (the same condition as in Evaluate).
+                const Hit light_hit = ray_sphere_intersection(shadow_rays[k], light_center, settings.sphere_light_radius + epsilon, i, false);
+                if (light_hit.t < packet.t[k]) {
+                    color += std::max(glm::dot(hit.normal, shadow_rays[k].direction), 0.0f) * lights[i].diffuse * hit.material.diffuse * (1.0f - fresnel) *
+                             attenuation / static_cast<float>(lights_count) / static_cast<float>(settings.shadow_samples);
+                }
+            }
+        }
+    }
+    return color;
+}
+
+glm::vec3 CPURayTracer::compute_rectangular_lights(const Hit& hit, glm::vec3 color, const glm::vec3& fresnel, const glm::vec3& attenuation) const {
+    for (int r = 0; r < static_cast<int>(rectangular_lights.size()); r++) {
+        const float form_factor = rectangular_light_form_factor(rectangular_lights[r], hit.intersection, hit.normal);
+        if (form_factor > 0.0f) {
+            color += form_factor * rectangular_light_visibility(hit, r) * glm::vec3(rectangular_lights[r].radiance) * hit.material.diffuse * (1.0f - fresnel) *
+                     attenuation;
+        }
+    }
+    return color;
+}
+
+float CPURayTracer::rectangular_light_visibility(const Hit& hit, int r) const {
+    const RectangularLightData& light = rectangular_lights[r];
+    const glm::vec3 light_normal = glm::normalize(glm::cross(glm::vec3(light.half_u), glm::vec3(light.half_v)));
+
+    // The samples are jittered in the cells of a grid that is as square as possible.
+    const int columns = std::max(1, static_cast<int>(std::sqrt(static_cast<float>(settings.shadow_samples))));
+    const int rows = (settings.shadow_samples + columns - 1) / columns;
+    const glm::vec2 seed = hash23(hit.intersection - glm::vec3(light.center));
+
+    float visible = 0.0f;
+    float total = 0.0f;
+    for (int first = 0; first < settings.shadow_samples; first += packet_size) {
+        const int count = std::min(packet_size, settings.shadow_samples - first);
+
+        float distances[packet_size];
+        float weights[packet_size];
+        RayPacket packet;
+        for (int k = 0; k < count; k++) {
+            const int j = first + k;
+            const glm::vec2 jitter = hash23(glm::vec3(seed, static_cast<float>(j + settings.frame_index * settings.shadow_samples)));
+            const glm::vec2 uv = (glm::vec2(static_cast<float>(j % columns), static_cast<float>(j / columns)) + jitter) /
+                                 glm::vec2(static_cast<float>(columns), static_cast<float>(rows));
+
+            const glm::vec3 to_light = rectangular_light_point(light, uv) - hit.intersection;
+            distances[k] = glm::length(to_light);
+            const glm::vec3 ray_dir = to_light / distances[k];
+            weights[k] = std::max(glm::dot(hit.normal, ray_dir), 0.0f) * std::max(glm::dot(light_normal, -ray_dir), 0.0f) / (distances[k] * distances[k]);
+            packet.set_ray(k, hit.intersection + epsilon * ray_dir, ray_dir);
+        }
+        packet.fill_unused(count);
+
+        // Only the ground and the spheres occlude the light.
+        evaluate_packet(packet);
+
+        for (int k = 0; k < count; k++) {
+            if (weights[k] <= 0.0f) {
+                continue;
+            }
+            total += weights[k];
+            if (packet.t[k] >= distances[k] - 2.0f * epsilon) {
+                visible += weights[k];
+            }
+        }
+    }
+    return total > 0.0f ? visible / total : 1.0f;
+}
+
+float CPURayTracer::sphere_light_visibility(const glm::vec3& position, const glm::vec3& light_center) const {
+    const glm::vec3 to_light = light_center - position;
+    const float light_distance = glm::length(to_light);
+    const glm::vec3 light_direction = to_light / light_distance;
+    const float light_angle = std::asin(std::min(settings.sphere_light_radius / light_distance, 1.0f));
+
+    // Visits only the BVH nodes intersecting the cone towards the light.
+    const float cone_radius = light_distance * std::tan(light_angle);
+    const glm::vec3 inv_direction = 1.0f / light_direction;
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    const std::vector<int>& indices = bvh.get_indices();
+    float visibility = 1.0f;
+    int stack[SphereBVH::max_depth];
+    int stack_size = 0;
+    int node_index = 0;
+    while (true) {
+        const BVHNode& node = nodes[node_index];
+        if (ray_box_intersection(position, inv_direction, node.bounds_min - cone_radius, node.bounds_max + cone_radius, light_distance)) {
+            if (node.is_leaf()) {
+                for (int k = node.first; k < node.first + node.count; k++) {
+                    const glm::vec4& sphere = field.spheres[indices[k]];
+                    const glm::vec3 to_sphere = glm::vec3(sphere) - position;
+                    const float sphere_distance = glm::length(to_sphere);
+                    if (sphere_distance <= sphere.w + epsilon || sphere_distance - sphere.w >= light_distance) {
+                        continue;
+                    }
+
+                    const float occluder_angle = std::asin(sphere.w / sphere_distance);
+                    const float angle_between = std::acos(glm::clamp(glm::dot(to_sphere / sphere_distance, light_direction), -1.0f, 1.0f));
+                    visibility *= 1.0f - cap_coverage(light_angle, occluder_angle, angle_between);
+                }
+                if (visibility <= 0.0f) {
+                    return 0.0f;
+                }
+            } else {
+                stack[stack_size++] = node.first;
+                node_index = node_index + 1;
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+    return visibility;
+}
+
+float CPURayTracer::occlude_ambient(const glm::vec3& position, const glm::vec3& normal) const {
+    // Visits only the BVH nodes closer than the occlusion distance.
+    const std::vector<BVHNode>& nodes = bvh.get_nodes();
+    const std::vector<int>& indices = bvh.get_indices();
+    float occlusion = 0.0f;
+    int stack[SphereBVH::max_depth];
+    int stack_size = 0;
+    int node_index = 0;
+    while (true) {
+        const BVHNode& node = nodes[node_index];
+        const glm::vec3 to_box = glm::max(glm::max(node.bounds_min - position, position - node.bounds_max), glm::vec3(0.0f));
+        if (glm::dot(to_box, to_box) < settings.occlusion_distance * settings.occlusion_distance) {
+            if (node.is_leaf()) {
+                for (int k = node.first; k < node.first + node.count; k++) {
+                    occlusion += sphere_occlusion(position, normal, field.spheres[indices[k]], settings.occlusion_distance);
+                }
+            } else {
+                stack[stack_size++] = node.first;
+                node_index = node_index + 1;
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+    return 1.0f - occlusion;
+}
+
+float CPURayTracer::compute_depth(const Hit& hit, const Ray& ray) const {
+    if (hit.t >= miss_t) {
+        return 1.0f;
+    }
+    const float d = glm::length(hit.intersection - ray.origin);
+    const float near_plane = camera.projection[3][2] / (camera.projection[2][2] - 1.0f);
+    const float far_plane = camera.projection[3][2] / (camera.projection[2][2] + 1.0f);
+    return (1 / d - 1 / near_plane) / (1 / far_plane - 1 / near_plane);
+}
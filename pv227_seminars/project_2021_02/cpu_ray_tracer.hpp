@@ -0,0 +1,251 @@
+#pragma once
+
+#include "camera_ubo.hpp"
+#include "light_ubo.hpp"
+#include "ray_packet.hpp"
+#include "rectangular_light.hpp"
+#include "snowman.hpp"
+#include "sphere_bvh.hpp"
+#include "tile_scheduler.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+/** The settings of the ray tracer, they correspond to the uniforms of 'ray_tracing.frag'. */
+struct CPURayTracerSettings {
+    /** The maximum number of bounces (the 'iterations' uniform). */
+    int iterations = 3;
+    /** The number of shadow rays per light and bounce. */
+    int shadow_samples = 16;
+    /** The flag determining if the ambient occlusion should be used. */
+    bool use_ambient_occlusion = true;
+    /** The radius of the spherical lights. */
+    float sphere_light_radius = 0.5f;
+    /** The distance at which the spheres stop contributing to the ambient occlusion. */
+    float occlusion_distance = 20.0f;
+    /** The flag determining if the shadows should be computed analytically instead of by the shadow rays. */
+    bool use_analytic_shadows = false;
+    /** The index of the frame that offsets the shadow samples (the 'frame_index' uniform). */
+    int frame_index = 0;
+    /** The flag determining if the hits should be classified by the probe rays before the shadow samples are traced. */
+    bool use_adaptive_shadows = false;
+    /** The flag determining if the path should stop when its throughput cannot contribute visibly. */
+    bool use_throughput_cutoff = false;
+    /** The flag determining if the paths with a low throughput should be randomly terminated (Russian roulette). */
+    bool use_russian_roulette = false;
+};
+
+/** The result of a comparison of two images. */
+struct ImageComparison {
+    /** The root mean square error computed over all color channels. */
+    float rmse = 0.0f;
+    /** The largest difference in a single color channel. */
+    float max_error = 0.0f;
+    /** The ratio of pixels whose largest channel difference exceeds the tolerance. */
+    float mismatch_ratio = 0.0f;
+};
+
+/**
+ * The CPU implementation of the ray tracer from 'shaders/ray_tracing.frag'. The methods mirror the functions of the
+ * shader (Trace, Evaluate, ComputeShadowRay, occlude_ambient, HandleDepth) including the hash used for the shadow
+ * samples, so the result matches the GPU image up to floating point differences and can be used as a reference.
+ * The blue noise shadow samples are not mirrored, the reference always uses the hash. The primary hits are always
+ * traced, hence the reference also validates the hybrid rendering from the rasterized G-buffer.
+ *
+ * The image is split into tiles that are rendered on all cores using @link TileScheduler. The primary rays and the
+ * bundles of shadow rays towards one light are coherent, hence they are intersected in packets using @link
+ * PacketIntersector; the reflected rays are traced one by one. The spheres are organized in @link SphereBVH that is
+ * traversed in the same way as in the shader.
+ */
+class CPURayTracer {
+    // ----------------------------------------------------------------------------
+    // Ray Tracing Structures
+    // ----------------------------------------------------------------------------
+protected:
+    /** The definition of a ray. */
+    struct Ray {
+        glm::vec3 origin;    // The ray origin.
+        glm::vec3 direction; // The ray direction.
+        int light_mask;      // The lights that can be hit by the ray.
+    };
+
+    /** The definition of an intersection. */
+    struct Hit {
+        float t;                  // The distance between the ray origin and the intersection points along the ray.
+        glm::vec3 intersection;   // The intersection point.
+        glm::vec3 normal;         // The surface normal at the intersection point.
+        PBRMaterialData material; // The material of the object at the intersection point.
+        int light_index;          // The index of the light that was hit, or -1.
+    };
+
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+protected:
+    /** The size of the square tiles distributed among the threads. */
+    static const int tile_size = 16;
+
+    /** The scheduler rendering the tiles. */
+    TileScheduler scheduler;
+
+    /** The SIMD kernels used for the packets of rays. */
+    PacketIntersector intersector;
+
+    /** The hierarchy over the spheres. */
+    SphereBVH bvh;
+
+    /** The spheres in the layout used by the packet kernels, sorted in the order of the BVH leaves. */
+    SphereSoA scene_spheres;
+
+    /** The spherical lights in the layout used by the packet kernels. */
+    SphereSoA light_spheres;
+
+    /** The spheres and materials of the rendered scene. */
+    SnowmanField field;
+
+    /** The lights in the scene. */
+    std::vector<PhongLightData> lights;
+
+    /** The rectangular lights in the scene. */
+    std::vector<RectangularLightData> rectangular_lights;
+
+    /** The camera used for rendering. */
+    CameraData camera;
+
+    /** The current settings. */
+    CPURayTracerSettings settings;
+
+    /** The width of the rendered image. */
+    int width = 0;
+
+    /** The height of the rendered image. */
+    int height = 0;
+
+    /** The rendered colors, rows are stored from bottom to top (as glReadPixels returns them). */
+    std::vector<glm::vec4> color;
+
+    /** The rendered depth (the same values the shader writes into gl_FragDepth). */
+    std::vector<float> depth;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Constructs a new @link CPURayTracer.
+     *
+     * @param 	thread_count	The number of threads to use (0 selects the number of cores).
+     */
+    CPURayTracer(unsigned int thread_count = 0);
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Sets the rendered spheres and builds the acceleration structures over them.
+     *
+     * @param 	field	The spheres and materials (the content of the sphere storage buffers).
+     */
+    void set_scene(const SnowmanField& field);
+
+    /**
+     * Renders the scene into the internal color and depth buffers.
+     *
+     * @param 	lights            	The lights (the content of the lights UBO).
+     * @param 	rectangular_lights	The rectangular lights (the used part of the rectangular lights buffer).
+     * @param 	camera            	The camera (the content of the camera UBO).
+     * @param 	settings          	The ray tracing settings.
+     * @param 	width             	The width of the image.
+     * @param 	height            	The height of the image.
+     */
+    void render(const std::vector<PhongLightData>& lights, const std::vector<RectangularLightData>& rectangular_lights, const CameraData& camera,
+                const CPURayTracerSettings& settings, int width, int height);
+
+    /**
+     * Compares two images of the same size. The colors are clamped to [0,1] as they would be when stored in the frame
+     * buffer.
+     *
+     * @param 	reference	The reference image.
+     * @param 	image	 	The compared image.
+     * @param 	tolerance	The largest channel difference of a pixel that is not considered a mismatch.
+     * @return	The statistics of the differences.
+     */
+    static ImageComparison compare(const std::vector<glm::vec4>& reference, const std::vector<glm::vec4>& image, float tolerance);
+
+protected:
+    /** Renders a single tile of the image. */
+    void render_tile(int tile);
+
+    /** Computes the primary ray of a pixel (the main method of the shader). */
+    Ray primary_ray(int x, int y) const;
+
+    /** Traces the ray trough the scene and accumulates the color; the first hit of the ray is already known. */
+    glm::vec3 trace(Ray ray, Hit hit, float& pixel_depth) const;
+
+    /** Evaluates the intersections of the ray with the scene objects and returns the closes hit. */
+    Hit evaluate(const Ray& ray) const;
+
+    /**
+     * Finds the closest intersections of the rays in the packet with the ground and the spheres. The object indices of
+     * the spheres are their positions in the BVH order (see @link make_hit).
+     */
+    void evaluate_packet(RayPacket& packet) const;
+
+    /** Returns the hit representing a ray that does not intersect anything. */
+    static Hit miss();
+
+    /** Converts the closest intersection found by the packet kernels into a hit. */
+    Hit make_hit(const Ray& ray, float t, int object) const;
+
+    /** Computes an intersection between a ray and a sphere defined by its center and radius. */
+    Hit ray_sphere_intersection(const Ray& ray, const glm::vec3& center, float radius, int i, bool is_snowman) const;
+
+    /** Computes an intersection between a ray and the emitting side of the r-th rectangular light. */
+    Hit ray_rectangle_intersection(const Ray& ray, int r) const;
+
+    /** Replaces the hit if the ray hits a rectangular light closer (only the primary and reflected rays see them). */
+    void intersect_rectangles(const Ray& ray, Hit& closest_hit) const;
+
+    /** Computes an intersection between a ray and a plane defined by its normal and one point inside the plane. */
+    Hit ray_plane_intersection(const Ray& ray, const glm::vec3& normal, const glm::vec3& point) const;
+
+    /** Accumulates the light contribution using the stochastic shadow rays, or the analytic visibility. */
+    glm::vec3 compute_shadow_ray(const Hit& hit, glm::vec3 color, const glm::vec3& fresnel, const glm::vec3& attenuation) const;
+
+    /** Accumulates the light of the rectangular lights: the analytic unshadowed light multiplied by the visibility. */
+    glm::vec3 compute_rectangular_lights(const Hit& hit, glm::vec3 color, const glm::vec3& fresnel, const glm::vec3& attenuation) const;
+
+    /** Computes the fraction of the light of the r-th rectangular light reaching the hit using stratified shadow rays. */
+    float rectangular_light_visibility(const Hit& hit, int r) const;
+
+    /** Computes the fraction of the spherical light visible from the position (see sphere_light_visibility in the shader). */
+    float sphere_light_visibility(const glm::vec3& position, const glm::vec3& light_center) const;
+
+    /** Computes the ambient occlusion caused by the spheres closer than the occlusion distance. */
+    float occlude_ambient(const glm::vec3& position, const glm::vec3& normal) const;
+
+    /** Computes the depth in the same way as the HandleDepth function in the shader. */
+    float compute_depth(const Hit& hit, const Ray& ray) const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+public:
+    /** Returns the rendered colors. */
+    const std::vector<glm::vec4>& get_color() const { return color; }
+
+    /** Returns the rendered depth. */
+    const std::vector<float>& get_depth() const { return depth; }
+
+    /** Returns the width of the rendered image. */
+    int get_width() const { return width; }
+
+    /** Returns the height of the rendered image. */
+    int get_height() const { return height; }
+
+    /** Returns the instruction set used for the packets of rays. */
+    SimdIsa get_isa() const { return intersector.get_isa(); }
+
+    /** Selects the instruction set used for the packets of rays (falls back to scalar code if it is not supported). */
+    void set_isa(SimdIsa isa) { intersector = PacketIntersector(isa); }
+};
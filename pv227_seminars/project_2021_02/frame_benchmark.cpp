@@ -0,0 +1,251 @@
+#define GLFW_INCLUDE_NONE
+
+#include "application.hpp"
+#include "camera_path.hpp"
+#include "manager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Deterministic benchmark of the whole frame.
+// The application is rendered offscreen through a fixed timeline (fixed time step, scripted camera, fixed scene and
+// quality settings) for several configurations, and the CPU and GPU frame times are reported as JSON.
+//
+// Usage: pv227_project_2021_02_frame_benchmark [--frames N] [--warmup N] [--frame-time MS] [--camera-path FILE]
+//                                              [--json FILE] [--headless]
+// ----------------------------------------------------------------------------
+
+/** One benchmarked configuration of the application. */
+struct BenchmarkConfiguration {
+    std::string name;
+    bool use_raytracing = false;
+    int reflections = 3;
+    int shadow_samples = 16;
+    int snow_count = 4096;
+    int snowman_count = 1;
+    bool snow_vertex_pulling = true;
+    bool analytic_shadows = false;
+    bool temporal_accumulation = false;
+    bool blue_noise_shadows = false;
+    bool rectangular_light = false;
+    bool adaptive_shadows = false;
+    bool throughput_cutoff = false;
+    bool russian_roulette = false;
+    bool hybrid = false;
+    bool wavefront = false;
+    bool dynamic_resolution = false;
+    int interleaving_period = 1;
+};
+
+/** The benchmarked configurations (the unspecified settings keep the defaults above). */
+const std::vector<BenchmarkConfiguration> configurations = {
+    {.name = "rasterization"},
+    {.name = "ray_tracing_1_reflection_1_shadow_sample", .use_raytracing = true, .reflections = 1, .shadow_samples = 1},
+    {.name = "ray_tracing_3_reflections_16_shadow_samples", .use_raytracing = true},
+    {.name = "ray_tracing_3_reflections_64_shadow_samples", .use_raytracing = true, .shadow_samples = 64},
+    {.name = "ray_tracing_100_snowmen", .use_raytracing = true, .snowman_count = 100},
+    {.name = "ray_tracing_3_reflections_analytic_shadows", .use_raytracing = true, .analytic_shadows = true},
+    {.name = "ray_tracing_100_snowmen_analytic_shadows", .use_raytracing = true, .snowman_count = 100, .analytic_shadows = true},
+    // Fewer shadow samples per frame accumulated over time.
+    {.name = "ray_tracing_3_reflections_4_shadow_samples_temporal", .use_raytracing = true, .shadow_samples = 4, .temporal_accumulation = true},
+    {.name = "ray_tracing_3_reflections_4_shadow_samples_blue_noise", .use_raytracing = true, .shadow_samples = 4, .blue_noise_shadows = true},
+    {.name = "ray_tracing_3_reflections_64_shadow_samples_adaptive", .use_raytracing = true, .shadow_samples = 64, .adaptive_shadows = true},
+    {.name = "ray_tracing_rectangular_light_16_shadow_samples", .use_raytracing = true, .rectangular_light = true},
+    // The time per frame versus the number of reflections without and with the termination of the reflected rays.
+    {.name = "ray_tracing_10_reflections", .use_raytracing = true, .reflections = 10},
+    {.name = "ray_tracing_10_reflections_cutoff", .use_raytracing = true, .reflections = 10, .throughput_cutoff = true},
+    {.name = "ray_tracing_10_reflections_russian_roulette", .use_raytracing = true, .reflections = 10, .russian_roulette = true},
+    {.name = "ray_tracing_100_reflections", .use_raytracing = true, .reflections = 100},
+    {.name = "ray_tracing_100_reflections_cutoff", .use_raytracing = true, .reflections = 100, .throughput_cutoff = true},
+    {.name = "ray_tracing_100_reflections_russian_roulette", .use_raytracing = true, .reflections = 100, .russian_roulette = true},
+    // The primary visibility rasterized into the G-buffer, only the secondary rays are traced.
+    {.name = "hybrid_3_reflections_16_shadow_samples", .use_raytracing = true, .hybrid = true},
+    {.name = "hybrid_100_snowmen", .use_raytracing = true, .snowman_count = 100, .hybrid = true},
+    // The ray tracing split into the stages with the queues of rays (compute shaders).
+    {.name = "wavefront_3_reflections_16_shadow_samples", .use_raytracing = true, .wavefront = true},
+    {.name = "wavefront_10_reflections_russian_roulette", .use_raytracing = true, .reflections = 10, .russian_roulette = true, .wavefront = true},
+    {.name = "wavefront_100_snowmen", .use_raytracing = true, .snowman_count = 100, .wavefront = true},
+    // Half or a quarter of the pixels traced in every frame, the others reconstructed.
+    {.name = "ray_tracing_3_reflections_64_shadow_samples_checkerboard", .use_raytracing = true, .shadow_samples = 64, .interleaving_period = 2},
+    {.name = "ray_tracing_3_reflections_64_shadow_samples_quarter", .use_raytracing = true, .shadow_samples = 64, .interleaving_period = 4},
+    // The resolution of the ray tracing lowered to hold the default target frame time.
+    {.name = "ray_tracing_10_reflections_64_shadow_samples_dynamic_resolution", .use_raytracing = true, .reflections = 10, .shadow_samples = 64,
+     .dynamic_resolution = true},
+    {.name = "rasterization_10000_snowmen", .snowman_count = 10000},
+    // The snow quads expanded by the geometry shader and by the vertex shader.
+    {.name = "snow_131072_geometry_shader", .snow_count = 131072, .snow_vertex_pulling = false},
+    {.name = "snow_131072_vertex_pulling", .snow_count = 131072},
+};
+
+/** The statistics of the measured frame times (in milliseconds). */
+struct FrameStatistics {
+    float min = 0.0f;
+    float median = 0.0f;
+    float p99 = 0.0f;
+
+    /** Computes the statistics of the samples. */
+    static FrameStatistics from_samples(std::vector<float> samples) {
+        FrameStatistics statistics;
+        if (samples.empty()) {
+            return statistics;
+        }
+        std::sort(samples.begin(), samples.end());
+        // The nearest-rank percentiles.
+        const auto percentile = [&](float p) { return samples[std::max<size_t>(1, static_cast<size_t>(std::ceil(p * samples.size()))) - 1]; };
+        statistics.min = samples.front();
+        statistics.median = percentile(0.5f);
+        statistics.p99 = percentile(0.99f);
+        return statistics;
+    }
+
+    /** Writes the statistics as a JSON object. */
+    void write_json(std::ostream& stream) const { stream << "{\"min\": " << min << ", \"median\": " << median << ", \"p99\": " << p99 << "}"; }
+};
+
+/** The application with access to the settings that are otherwise changed only from the GUI. */
+class BenchmarkApplication : public Application {
+  public:
+    using Application::Application;
+
+    /** Applies the configuration and restarts the timeline (the changes of the scene are applied in the next update). */
+    void configure(const BenchmarkConfiguration& configuration) {
+        use_raytracing = configuration.use_raytracing;
+        use_cpu_raytracing = false;
+        reflections = configuration.reflections;
+        shadow_samples = configuration.shadow_samples;
+        desired_snow_count = configuration.snow_count;
+        desired_snowman_count = configuration.snowman_count;
+        show_snow = true;
+        use_snow_vertex_pulling = configuration.snow_vertex_pulling;
+        use_analytic_shadows = configuration.analytic_shadows;
+        use_temporal_accumulation = configuration.temporal_accumulation;
+        use_blue_noise_shadows = configuration.blue_noise_shadows;
+        use_rectangular_light = configuration.rectangular_light;
+        use_adaptive_shadows = configuration.adaptive_shadows;
+        use_throughput_cutoff = configuration.throughput_cutoff;
+        use_russian_roulette = configuration.russian_roulette;
+        use_hybrid_rendering = configuration.hybrid;
+        use_wavefront_raytracing = configuration.wavefront;
+        use_dynamic_resolution = configuration.dynamic_resolution;
+        resolution_scale = 1.0f;
+        interleaving_period = configuration.interleaving_period;
+        elapsed_time = 0;
+
+        // The particles are reset even if their count does not change so that every configuration starts from the same state.
+        current_snow_count = desired_snow_count;
+        reset_particles();
+    }
+
+    /** Returns the GPU time of the last frame that was read back (in milliseconds). */
+    float get_gpu_frame_time() const { return gpu_timer.get_frame_time(); }
+
+    /** Returns the number of frames between rendering a frame and reading back its GPU time. */
+    int get_gpu_latency() const { return gpu_timer.get_latency(); }
+};
+
+/** Returns the default camera path: one orbit around the snowman while zooming in and out. */
+CameraPath create_default_camera_path(float duration) {
+    CameraPath path;
+    path.add_keyframe(0.0f, glm::radians(-45.0f), glm::radians(20.0f), 25.0f);
+    path.add_keyframe(duration * 0.25f, glm::radians(45.0f), glm::radians(10.0f), 15.0f);
+    path.add_keyframe(duration * 0.5f, glm::radians(135.0f), glm::radians(30.0f), 35.0f);
+    path.add_keyframe(duration * 0.75f, glm::radians(225.0f), glm::radians(5.0f), 12.0f);
+    path.add_keyframe(duration, glm::radians(315.0f), glm::radians(20.0f), 25.0f);
+    return path;
+}
+
+int main(int argc, char** argv) {
+    const int width = 1280;
+    const int height = 720;
+
+    std::vector<std::string> arguments(argv, argv + argc);
+
+    // The common options are shared with the offline rendering, the default number of frames is larger.
+    OfflineSettings settings = OfflineSettings::from_arguments(arguments);
+    settings.output.clear();
+    int frames = 300;
+    int warmup = 30;
+    std::filesystem::path json_path;
+    for (size_t i = 1; i + 1 < arguments.size(); i++) {
+        if (arguments[i] == "--frames") {
+            frames = std::max(1, std::atoi(arguments[i + 1].c_str()));
+        } else if (arguments[i] == "--warmup") {
+            warmup = std::max(0, std::atoi(arguments[i + 1].c_str()));
+        } else if (arguments[i] == "--json") {
+            json_path = arguments[i + 1];
+        }
+    }
+
+    OpenGLManager manager;
+    manager.set_headless(settings.enabled);
+    manager.init(width, height, "PV227 Project #01 Benchmark", 4, 5);
+    if (manager.is_fail()) {
+        manager.terminate();
+        return 1;
+    }
+
+    std::ostringstream json;
+    {
+        BenchmarkApplication application(width, height, arguments);
+        const int latency = application.get_gpu_latency();
+
+        // The default camera path is used if no path is provided; it spans all frames of one configuration.
+        const CameraPath default_path = create_default_camera_path((warmup + frames + latency) * settings.frame_time);
+
+        json << "{\n  \"frame_time\": " << settings.frame_time << ",\n  \"frames\": " << frames << ",\n  \"warmup\": " << warmup
+             << ",\n  \"width\": " << width << ",\n  \"height\": " << height << ",\n  \"configurations\": [";
+        for (size_t c = 0; c < configurations.size(); c++) {
+            const BenchmarkConfiguration& configuration = configurations[c];
+            std::cerr << "Benchmarking " << configuration.name << "..." << std::endl;
+            application.configure(configuration);
+
+            // The GPU time of a frame is available only after the latency of the timer, hence the extra frames.
+            settings.frames = warmup + frames + latency;
+            std::vector<float> cpu_times;
+            std::vector<float> gpu_times;
+            auto last = std::chrono::steady_clock::now();
+            const auto on_frame = [&](int frame) {
+                const auto now = std::chrono::steady_clock::now();
+                if (frame >= warmup && frame < warmup + frames) {
+                    cpu_times.push_back(std::chrono::duration<float, std::milli>(now - last).count());
+                }
+                if (frame >= warmup + latency) {
+                    gpu_times.push_back(application.get_gpu_frame_time());
+                }
+                last = now;
+            };
+            if (settings.camera_path.empty()) {
+                // The camera is moved for the next frame, which is updated and rendered after the callback returns.
+                const auto on_frame_with_path = [&](int frame) {
+                    on_frame(frame);
+                    default_path.apply((frame + 1) * settings.frame_time, application.get_camera());
+                };
+                default_path.apply(0.0f, application.get_camera());
+                manager.run_offline(application, settings, on_frame_with_path);
+            } else {
+                manager.run_offline(application, settings, on_frame);
+            }
+
+            json << (c == 0 ? "" : ",") << "\n    {\"name\": \"" << configuration.name << "\", \"cpu\": ";
+            FrameStatistics::from_samples(cpu_times).write_json(json);
+            json << ", \"gpu\": ";
+            FrameStatistics::from_samples(gpu_times).write_json(json);
+            json << "}";
+        }
+        json << "\n  ]\n}\n";
+    }
+    manager.terminate();
+
+    if (json_path.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream(json_path) << json.str();
+    }
+    return 0;
+}
@@ -11,19 +11,30 @@ int main(int argc, char** argv) {
 
     std::vector<std::string> arguments(argv, argv + argc);
 
+    // E.g., '--headless --frames 120 --output frames/snowman.png --camera-path path.txt' renders 120 frames without a window.
+    const OfflineSettings offline_settings = OfflineSettings::from_arguments(arguments);
+    int result = 0;
+
     OpenGLManager manager;
+    manager.set_headless(offline_settings.enabled);
     manager.init(initial_width, initial_height, "PV227 Project #01", 4, 5);
-    if(!manager.is_fail()) 
+    if(!manager.is_fail())
     {
         // Note that the application has to be created after the manager is initialized.
         Application application(initial_width, initial_height, arguments);
-        manager.run(application);
+        if (offline_settings.enabled) {
+            result = manager.run_offline(application, offline_settings) ? 0 : 1;
+        } else {
+            manager.run(application);
+        }
 
         // Free the entire application before terminating glfw. If this were done in the wrong order
         // application may crash on calling OpenGL (Delete*) calls after destruction of a context.
         // Freeing is done implicitly by enclosing this part of code in block {}.
+    } else {
+        result = 1;
     }
 
     manager.terminate();
-    return 0;
+    return result;
 }
@@ -0,0 +1,298 @@
+#include "ray_packet.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RAY_PACKET_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile the SSE and AVX2 kernels only when the target is enabled for the function; MSVC allows the
+// intrinsics anywhere. The kernels are called only when the CPU supports them.
+#if defined(RAY_PACKET_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE
+#define TARGET_AVX2
+#endif
+
+// ----------------------------------------------------------------------------
+// Ray Packet
+// ----------------------------------------------------------------------------
+void RayPacket::set_ray(int lane, const glm::vec3& origin, const glm::vec3& direction) {
+    origin_x[lane] = origin.x;
+    origin_y[lane] = origin.y;
+    origin_z[lane] = origin.z;
+    direction_x[lane] = direction.x;
+    direction_y[lane] = direction.y;
+    direction_z[lane] = direction.z;
+    t[lane] = 1e20f;
+    object[lane] = miss;
+}
+
+void RayPacket::fill_unused(int count) {
+    for (int lane = count; lane < packet_size; lane++) {
+        set_ray(lane, glm::vec3(origin_x[0], origin_y[0], origin_z[0]), glm::vec3(direction_x[0], direction_y[0], direction_z[0]));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Sphere Storage
+// ----------------------------------------------------------------------------
+void SphereSoA::clear() {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    radius_squared.clear();
+}
+
+void SphereSoA::add(const glm::vec3& center, float radius) {
+    center_x.push_back(center.x);
+    center_y.push_back(center.y);
+    center_z.push_back(center.z);
+    radius_squared.push_back(radius * radius);
+}
+
+void SphereSoA::assign(const glm::vec4* spheres, int count) {
+    clear();
+    for (int i = 0; i < count; i++) {
+        add(glm::vec3(spheres[i]), spheres[i].w);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Kernels
+// ----------------------------------------------------------------------------
+namespace {
+void intersect_ground_scalar(RayPacket& packet, float extent) {
+    for (int i = 0; i < packet_size; i++) {
+        const float t = -packet.origin_y[i] / packet.direction_y[i];
+        const float x = packet.origin_x[i] + t * packet.direction_x[i];
+        const float z = packet.origin_z[i] + t * packet.direction_z[i];
+        if (t >= 0.0f && x <= extent && x >= -extent && z <= extent && z >= -extent && t < packet.t[i]) {
+            packet.t[i] = t;
+            packet.object[i] = RayPacket::ground;
+        }
+    }
+}
+
+void intersect_spheres_scalar(const SphereSoA& spheres, int begin, int end, RayPacket& packet, int first_index) {
+    for (int s = begin; s < end; s++) {
+        for (int i = 0; i < packet_size; i++) {
+            const float ocx = packet.origin_x[i] - spheres.get_center_x()[s];
+            const float ocy = packet.origin_y[i] - spheres.get_center_y()[s];
+            const float ocz = packet.origin_z[i] - spheres.get_center_z()[s];
+            const float b = packet.direction_x[i] * ocx + packet.direction_y[i] * ocy + packet.direction_z[i] * ocz;
+            const float c = (ocx * ocx + ocy * ocy + ocz * ocz) - spheres.get_radius_squared()[s];
+            const float det = b * b - c;
+            if (det < 0.0f) continue;
+
+            float t = -b - std::sqrt(det);
+            if (t < 0.0f) t = -b + std::sqrt(det);
+            if (t >= 0.0f && t < packet.t[i]) {
+                packet.t[i] = t;
+                packet.object[i] = first_index + s;
+            }
+        }
+    }
+}
+
+#ifdef RAY_PACKET_X86
+TARGET_SSE void intersect_ground_sse(RayPacket& packet, float extent) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max = _mm_set1_ps(extent);
+    const __m128 min = _mm_set1_ps(-extent);
+    const __m128i ground = _mm_set1_epi32(RayPacket::ground);
+
+    // One SSE register holds half of the packet.
+    for (int i = 0; i < packet_size; i += 4) {
+        const __m128 t = _mm_div_ps(_mm_sub_ps(zero, _mm_load_ps(packet.origin_y + i)), _mm_load_ps(packet.direction_y + i));
+        const __m128 x = _mm_add_ps(_mm_load_ps(packet.origin_x + i), _mm_mul_ps(t, _mm_load_ps(packet.direction_x + i)));
+        const __m128 z = _mm_add_ps(_mm_load_ps(packet.origin_z + i), _mm_mul_ps(t, _mm_load_ps(packet.direction_z + i)));
+        const __m128 best_t = _mm_load_ps(packet.t + i);
+
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, best_t));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(x, max), _mm_cmpge_ps(x, min)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(z, max), _mm_cmpge_ps(z, min)));
+
+        // SSE2 has no blend, hence the selection is done with and/andnot/or.
+        const __m128i hit_i = _mm_castps_si128(hit);
+        const __m128i best_object = _mm_load_si128(reinterpret_cast<const __m128i*>(packet.object + i));
+        _mm_store_ps(packet.t + i, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, best_t)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(packet.object + i), _mm_or_si128(_mm_and_si128(hit_i, ground), _mm_andnot_si128(hit_i, best_object)));
+    }
+}
+
+TARGET_SSE void intersect_spheres_sse(const SphereSoA& spheres, int begin, int end, RayPacket& packet, int first_index) {
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int i = 0; i < packet_size; i += 4) {
+        const __m128 ox = _mm_load_ps(packet.origin_x + i);
+        const __m128 oy = _mm_load_ps(packet.origin_y + i);
+        const __m128 oz = _mm_load_ps(packet.origin_z + i);
+        const __m128 dx = _mm_load_ps(packet.direction_x + i);
+        const __m128 dy = _mm_load_ps(packet.direction_y + i);
+        const __m128 dz = _mm_load_ps(packet.direction_z + i);
+        __m128 best_t = _mm_load_ps(packet.t + i);
+        __m128i best_object = _mm_load_si128(reinterpret_cast<const __m128i*>(packet.object + i));
+
+        for (int s = begin; s < end; s++) {
+            const __m128 ocx = _mm_sub_ps(ox, _mm_set1_ps(spheres.get_center_x()[s]));
+            const __m128 ocy = _mm_sub_ps(oy, _mm_set1_ps(spheres.get_center_y()[s]));
+            const __m128 ocz = _mm_sub_ps(oz, _mm_set1_ps(spheres.get_center_z()[s]));
+            const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ocx), _mm_mul_ps(dy, ocy)), _mm_mul_ps(dz, ocz));
+            const __m128 oc2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+            const __m128 c = _mm_sub_ps(oc2, _mm_set1_ps(spheres.get_radius_squared()[s]));
+            const __m128 det = _mm_sub_ps(_mm_mul_ps(b, b), c);
+
+            // The square root of a negative determinant is NaN, such lanes are masked out below.
+            const __m128 sq = _mm_sqrt_ps(det);
+            const __m128 nb = _mm_sub_ps(zero, b);
+            const __m128 near_t = _mm_sub_ps(nb, sq);
+            const __m128 far_t = _mm_add_ps(nb, sq);
+            const __m128 use_far = _mm_cmplt_ps(near_t, zero);
+            const __m128 t = _mm_or_ps(_mm_and_ps(use_far, far_t), _mm_andnot_ps(use_far, near_t));
+
+            const __m128 hit = _mm_and_ps(_mm_cmpge_ps(det, zero), _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, best_t)));
+            const __m128i hit_i = _mm_castps_si128(hit);
+            best_t = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, best_t));
+            best_object = _mm_or_si128(_mm_and_si128(hit_i, _mm_set1_epi32(first_index + s)), _mm_andnot_si128(hit_i, best_object));
+        }
+
+        _mm_store_ps(packet.t + i, best_t);
+        _mm_store_si128(reinterpret_cast<__m128i*>(packet.object + i), best_object);
+    }
+}
+
+TARGET_AVX2 void intersect_ground_avx2(RayPacket& packet, float extent) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max = _mm256_set1_ps(extent);
+    const __m256 min = _mm256_set1_ps(-extent);
+
+    const __m256 t = _mm256_div_ps(_mm256_sub_ps(zero, _mm256_load_ps(packet.origin_y)), _mm256_load_ps(packet.direction_y));
+    const __m256 x = _mm256_add_ps(_mm256_load_ps(packet.origin_x), _mm256_mul_ps(t, _mm256_load_ps(packet.direction_x)));
+    const __m256 z = _mm256_add_ps(_mm256_load_ps(packet.origin_z), _mm256_mul_ps(t, _mm256_load_ps(packet.direction_z)));
+    const __m256 best_t = _mm256_load_ps(packet.t);
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, best_t, _CMP_LT_OQ));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(x, max, _CMP_LE_OQ), _mm256_cmp_ps(x, min, _CMP_GE_OQ)));
+    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(z, max, _CMP_LE_OQ), _mm256_cmp_ps(z, min, _CMP_GE_OQ)));
+
+    const __m256i best_object = _mm256_load_si256(reinterpret_cast<const __m256i*>(packet.object));
+    _mm256_store_ps(packet.t, _mm256_blendv_ps(best_t, t, hit));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(packet.object), _mm256_blendv_epi8(best_object, _mm256_set1_epi32(RayPacket::ground), _mm256_castps_si256(hit)));
+}
+
+TARGET_AVX2 void intersect_spheres_avx2(const SphereSoA& spheres, int begin, int end, RayPacket& packet, int first_index) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 ox = _mm256_load_ps(packet.origin_x);
+    const __m256 oy = _mm256_load_ps(packet.origin_y);
+    const __m256 oz = _mm256_load_ps(packet.origin_z);
+    const __m256 dx = _mm256_load_ps(packet.direction_x);
+    const __m256 dy = _mm256_load_ps(packet.direction_y);
+    const __m256 dz = _mm256_load_ps(packet.direction_z);
+    __m256 best_t = _mm256_load_ps(packet.t);
+    __m256i best_object = _mm256_load_si256(reinterpret_cast<const __m256i*>(packet.object));
+
+    // Note that the multiplications and additions are not fused so that the results match the scalar code.
+    for (int s = begin; s < end; s++) {
+        const __m256 ocx = _mm256_sub_ps(ox, _mm256_set1_ps(spheres.get_center_x()[s]));
+        const __m256 ocy = _mm256_sub_ps(oy, _mm256_set1_ps(spheres.get_center_y()[s]));
+        const __m256 ocz = _mm256_sub_ps(oz, _mm256_set1_ps(spheres.get_center_z()[s]));
+        const __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ocx), _mm256_mul_ps(dy, ocy)), _mm256_mul_ps(dz, ocz));
+        const __m256 oc2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+        const __m256 c = _mm256_sub_ps(oc2, _mm256_set1_ps(spheres.get_radius_squared()[s]));
+        const __m256 det = _mm256_sub_ps(_mm256_mul_ps(b, b), c);
+
+        // The square root of a negative determinant is NaN, such lanes are masked out below.
+        const __m256 sq = _mm256_sqrt_ps(det);
+        const __m256 nb = _mm256_sub_ps(zero, b);
+        const __m256 near_t = _mm256_sub_ps(nb, sq);
+        const __m256 t = _mm256_blendv_ps(near_t, _mm256_add_ps(nb, sq), _mm256_cmp_ps(near_t, zero, _CMP_LT_OQ));
+
+        const __m256 hit =
+            _mm256_and_ps(_mm256_cmp_ps(det, zero, _CMP_GE_OQ), _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, best_t, _CMP_LT_OQ)));
+        best_t = _mm256_blendv_ps(best_t, t, hit);
+        best_object = _mm256_blendv_epi8(best_object, _mm256_set1_epi32(first_index + s), _mm256_castps_si256(hit));
+    }
+
+    _mm256_store_ps(packet.t, best_t);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(packet.object), best_object);
+}
+#endif
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+PacketIntersector::PacketIntersector() : PacketIntersector(detect_isa()) {}
+
+PacketIntersector::PacketIntersector(SimdIsa isa) : isa(is_supported(isa) ? isa : SimdIsa::Scalar) {
+    ground_kernel = intersect_ground_scalar;
+    spheres_kernel = intersect_spheres_scalar;
+#ifdef RAY_PACKET_X86
+    if (this->isa == SimdIsa::SSE) {
+        ground_kernel = intersect_ground_sse;
+        spheres_kernel = intersect_spheres_sse;
+    } else if (this->isa == SimdIsa::AVX2) {
+        ground_kernel = intersect_ground_avx2;
+        spheres_kernel = intersect_spheres_avx2;
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+SimdIsa PacketIntersector::detect_isa() {
+    if (is_supported(SimdIsa::AVX2)) {
+        return SimdIsa::AVX2;
+    }
+    if (is_supported(SimdIsa::SSE)) {
+        return SimdIsa::SSE;
+    }
+    return SimdIsa::Scalar;
+}
+
+bool PacketIntersector::is_supported(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::Scalar:
+        return true;
+#if defined(RAY_PACKET_X86) && defined(_MSC_VER)
+    case SimdIsa::SSE: {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+    }
+    case SimdIsa::AVX2: {
+        int info[4];
+        __cpuid(info, 1);
+        // The operating system must save the YMM registers (OSXSAVE and XCR0 bits 1 and 2).
+        const bool os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return os_avx && (info[1] & (1 << 5)) != 0;
+    }
+#elif defined(RAY_PACKET_X86)
+    case SimdIsa::SSE:
+        return __builtin_cpu_supports("sse2");
+    case SimdIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* PacketIntersector::get_isa_name(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::SSE:
+        return "SSE";
+    case SimdIsa::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
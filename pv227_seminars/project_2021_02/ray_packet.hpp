@@ -0,0 +1,157 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/** The number of rays traced together in one packet (the width of an AVX register). */
+const int packet_size = 8;
+
+/** The instruction sets the packet kernels are implemented for. */
+enum class SimdIsa { Scalar, SSE, AVX2 };
+
+/**
+ * The packet of rays stored as a structure of arrays, so that one SIMD register holds the same component of all
+ * rays. Besides the rays, the packet stores the closest intersection found so far.
+ */
+struct RayPacket {
+    /** The object index of a ray that did not hit anything. */
+    static const int miss = -1;
+    /** The object index of a ray that hit the ground plane. */
+    static const int ground = -2;
+
+    alignas(32) float origin_x[packet_size];
+    alignas(32) float origin_y[packet_size];
+    alignas(32) float origin_z[packet_size];
+    alignas(32) float direction_x[packet_size];
+    alignas(32) float direction_y[packet_size];
+    alignas(32) float direction_z[packet_size];
+    /** The distance to the closest intersection along each ray. */
+    alignas(32) float t[packet_size];
+    /** The index of the closest object (@link miss, @link ground or an index of a sphere). */
+    alignas(32) int object[packet_size];
+
+    /** Sets the ray in the specified lane and resets its intersection. */
+    void set_ray(int lane, const glm::vec3& origin, const glm::vec3& direction);
+
+    /** Copies the first ray into the lanes [count, packet_size) so that partially filled packets can be traced as well. */
+    void fill_unused(int count);
+};
+
+/**
+ * The spheres stored as a structure of arrays. The squared radii are stored directly since it is the only form the
+ * intersection test needs.
+ */
+class SphereSoA {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+protected:
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius_squared;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+public:
+    /** Removes all spheres. */
+    void clear();
+
+    /** Adds a sphere defined by its center and radius. */
+    void add(const glm::vec3& center, float radius);
+
+    /** Replaces the content by spheres stored as (center, radius). */
+    void assign(const glm::vec4* spheres, int count);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+public:
+    int size() const { return static_cast<int>(radius_squared.size()); }
+    const float* get_center_x() const { return center_x.data(); }
+    const float* get_center_y() const { return center_y.data(); }
+    const float* get_center_z() const { return center_z.data(); }
+    const float* get_radius_squared() const { return radius_squared.data(); }
+};
+
+/**
+ * Intersects packets of rays with the scene primitives using the best instruction set supported by the CPU (or the
+ * one requested explicitly). The math is the same as in RaySphereIntersection and RayPlaneIntersection in
+ * 'shaders/ray_tracing.frag', each lane keeps the closest intersection, and the ties are resolved in favor of the
+ * earlier object exactly as in Evaluate.
+ */
+class PacketIntersector {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+protected:
+    /** The instruction set used by the kernels. */
+    SimdIsa isa;
+
+    /** The kernel intersecting the rays with the ground plane. */
+    void (*ground_kernel)(RayPacket& packet, float extent);
+
+    /** The kernel intersecting the rays with the spheres. */
+    void (*spheres_kernel)(const SphereSoA& spheres, int begin, int end, RayPacket& packet, int first_index);
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+public:
+    /** Constructs a new @link PacketIntersector using the best instruction set supported by the CPU. */
+    PacketIntersector();
+
+    /** Constructs a new @link PacketIntersector using the specified instruction set (it must be supported). */
+    explicit PacketIntersector(SimdIsa isa);
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Intersects the rays with the ground plane y = 0 that is bounded to [-extent, extent] in X and Z.
+     *
+     * @param 	packet	The rays, the closest intersection is updated.
+     * @param 	extent	The extent of the plane.
+     */
+    void intersect_ground(RayPacket& packet, float extent = 100.0f) const { ground_kernel(packet, extent); }
+
+    /**
+     * Intersects the rays with all spheres.
+     *
+     * @param 	spheres	   	The spheres.
+     * @param 	packet	   	The rays, the closest intersection is updated.
+     * @param 	first_index	The object index of the first sphere (the others follow consecutively).
+     */
+    void intersect_spheres(const SphereSoA& spheres, RayPacket& packet, int first_index = 0) const { spheres_kernel(spheres, 0, spheres.size(), packet, first_index); }
+
+    /**
+     * Intersects the rays with the spheres [begin, end), e.g., the spheres of one BVH leaf.
+     *
+     * @param 	spheres	   	The spheres.
+     * @param 	begin	   	The index of the first tested sphere.
+     * @param 	end		   	The index after the last tested sphere.
+     * @param 	packet	   	The rays, the closest intersection is updated.
+     * @param 	first_index	The object index of the sphere with index 0 (the object index of sphere s is first_index + s).
+     */
+    void intersect_spheres(const SphereSoA& spheres, int begin, int end, RayPacket& packet, int first_index = 0) const {
+        spheres_kernel(spheres, begin, end, packet, first_index);
+    }
+
+    /** Returns the best instruction set supported by the CPU. */
+    static SimdIsa detect_isa();
+
+    /** Checks if the CPU (and the build) supports the specified instruction set. */
+    static bool is_supported(SimdIsa isa);
+
+    /** Returns a human readable name of the instruction set. */
+    static const char* get_isa_name(SimdIsa isa);
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+public:
+    /** Returns the instruction set used by the kernels. */
+    SimdIsa get_isa() const { return isa; }
+};
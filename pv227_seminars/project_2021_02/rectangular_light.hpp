@@ -0,0 +1,44 @@
+#pragma once
+#include "glm/glm.hpp"
+
+/**
+ * The data of one rectangular area light. The light emits the constant radiance from the front side of the rectangle,
+ * i.e., in the direction of cross(half_u, half_v). The data are uploaded into a shader storage buffer with the std430
+ * layout matching 'shaders/rectangular_lights.glsl':
+ * <code>
+ * layout (std430, binding = 13) readonly buffer RectangularLightsBuffer { RectangularLight rectangular_lights[]; };
+ * </code>
+ */
+struct RectangularLightData {
+    /** The center of the rectangle (w is unused). */
+    glm::vec4 center{};
+    /** The half of the first edge of the rectangle (w is unused). */
+    glm::vec4 half_u{};
+    /** The half of the second edge of the rectangle (w is unused). */
+    glm::vec4 half_v{};
+    /** The emitted radiance (w is unused). */
+    glm::vec4 radiance{};
+
+    // ----------------------------------------------------------------------------
+    // Factory Methods
+    // ----------------------------------------------------------------------------
+  public:
+    /**
+     * Factory method for a rectangular light facing the target; the first edge of the rectangle is horizontal.
+     *
+     * @param 	center  	The center of the rectangle.
+     * @param 	target  	The point the light faces, it must not be straight above or below the center.
+     * @param 	width   	The length of the horizontal edge.
+     * @param 	height  	The length of the other edge.
+     * @param 	radiance	The emitted radiance.
+     */
+    static RectangularLightData CreateFacing(const glm::vec3& center, const glm::vec3& target, float width, float height, const glm::vec3& radiance) {
+        const glm::vec3 normal = glm::normalize(target - center);
+        const glm::vec3 u = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), normal));
+        const glm::vec3 v = glm::cross(normal, u);
+        return RectangularLightData{glm::vec4(center, 1.0f), glm::vec4(u * (0.5f * width), 0.0f), glm::vec4(v * (0.5f * height), 0.0f),
+                                    glm::vec4(radiance, 1.0f)};
+    }
+};
+
+static_assert(sizeof(RectangularLightData) == 64, "Incorrect RectangularLightData layout.");
@@ -0,0 +1,30 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+in VertexData
+{
+	vec2 tex_coord;
+} in_data;
+
+// The colors computed by the CPU ray tracer.
+layout (binding = 0) uniform sampler2D color_texture;
+// The depth computed by the CPU ray tracer.
+layout (binding = 1) uniform sampler2D depth_texture;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+// The final output color.
+layout (location = 0) out vec4 final_color;
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	final_color = texelFetch(color_texture, pixel, 0);
+	gl_FragDepth = texelFetch(depth_texture, pixel, 0).r;
+}
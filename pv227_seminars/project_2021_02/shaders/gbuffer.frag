@@ -0,0 +1,53 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+in VertexData
+{
+	vec3 position_ws;	  // The vertex position in world space.
+	vec3 normal_ws;		  // The vertex normal in world space.
+	vec2 tex_coord;		  // The vertex texture coordinates.
+} in_data;
+
+// The index of the instance, the spheres of the snowmen come first and their instances match the spheres in SphereBuffer.
+flat in int instance_index;
+
+#pragma include spheres.glsl
+
+// The number of spheres, the instance after them is the floor.
+uniform int spheres_count;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+// The position of the surface in world space.
+layout (location = 0) out vec4 position_ws;
+// The normal of the surface in world space.
+layout (location = 1) out vec4 normal_ws;
+// The index of the material in SphereMaterialBuffer (the framebuffer is cleared to -1 where nothing is rasterized).
+layout (location = 2) out int material_id;
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+void main()
+{
+	if (instance_index < spheres_count)
+	{
+		// The mesh only approximates the sphere, the position is moved onto the exact surface so that the secondary
+		// rays traced from it do not hit the sphere itself.
+		vec4 sphere = sphere_positions[instance_index];
+		vec3 normal = normalize(in_data.position_ws - sphere.xyz);
+		position_ws = vec4(sphere.xyz + sphere.w * normal, 1.0);
+		normal_ws = vec4(normal, 0.0);
+		material_id = instance_index;
+	}
+	else
+	{
+		// The floor has the material of the first sphere like the ground plane in the ray tracing.
+		position_ws = vec4(in_data.position_ws, 1.0);
+		normal_ws = vec4(normalize(in_data.normal_ws), 0.0);
+		material_id = 0;
+	}
+}
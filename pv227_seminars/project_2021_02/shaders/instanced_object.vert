@@ -0,0 +1,68 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+layout (location = 0) in vec4 position;  // The vertex position.
+layout (location = 1) in vec3 normal;	 // The vertex normal.
+layout (location = 2) in vec2 tex_coord; // The vertex texture coordinates.
+
+// The UBO with camera data.
+layout (std140, binding = 0) uniform CameraBuffer
+{
+	mat4 projection;		// The projection matrix.
+	mat4 projection_inv;	// The inverse of the projection matrix.
+	mat4 view;				// The view matrix
+	mat4 view_inv;			// The inverse of the view matrix.
+	mat3 view_it;			// The inverse of the transpose of the top-left part 3x3 of the view matrix
+	vec3 eye_position;		// The position of the eye in world space.
+};
+
+// The data of a single instance (see InstanceData in application.hpp).
+struct InstanceData
+{
+	mat4 model;		// The model matrix (without any shear, see the computation of the normal below).
+	int material;	// The index of the material in PhongMaterialBuffer.
+};
+
+// The data of all rasterized instances.
+layout (std430, binding = 7) readonly buffer InstanceBuffer
+{
+	InstanceData instances[];
+};
+
+// The index of the instance rendered by gl_InstanceID = 0.
+uniform int first_instance;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+out VertexData
+{
+	vec3 position_ws;	  // The vertex position in world space.
+	vec3 normal_ws;		  // The vertex normal in world space.
+	vec2 tex_coord;		  // The vertex texture coordinates.
+} out_data;
+
+// The index of the material of the instance.
+flat out int material_index;
+// The index of the instance in InstanceBuffer.
+flat out int instance_index;
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+void main()
+{
+	InstanceData instance = instances[first_instance + gl_InstanceID];
+
+	out_data.tex_coord = tex_coord;
+	out_data.position_ws = vec3(instance.model * position);
+	// The instances are only translated, rotated and scaled, so the model matrix itself keeps the normals of
+	// the spheres (uniform scale) and of the floor box (axis-aligned faces) perpendicular to the surface.
+	out_data.normal_ws = normalize(mat3(instance.model) * normal);
+	material_index = instance.material;
+	instance_index = first_instance + gl_InstanceID;
+
+	gl_Position = projection * view * instance.model * position;
+}
@@ -0,0 +1,143 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+in VertexData
+{
+	vec2 tex_coord;
+} in_data;
+
+// The UBO with camera data.
+layout (std140, binding = 0) uniform CameraBuffer
+{
+	mat4 projection;	  // The projection matrix.
+	mat4 projection_inv;  // The inverse of the projection matrix.
+	mat4 view;			  // The view matrix
+	mat4 view_inv;		  // The inverse of the view matrix.
+	mat3 view_it;		  // The inverse of the transpose of the top-left part 3x3 of the view matrix
+	vec3 eye_position;	  // The position of the eye in world space.
+};
+
+#pragma include interleaving.glsl
+
+// The colors, the normals and the depths of the primary hits; the pixels that are not traced in the current frame
+// hold the values traced in the previous frames.
+layout (binding = 0) uniform sampler2D traced_color_texture;
+layout (binding = 1) uniform sampler2D traced_normal_texture;
+layout (binding = 2) uniform sampler2D traced_depth_texture;
+
+// The windows size.
+uniform vec2 resolution;
+
+// The relative difference of the distances from the eye above which the pixels are on different surfaces.
+const float max_distance_difference = 0.05;
+// The exponent of the cosine between the normals, the higher exponent separates the surfaces with closer normals.
+const float normal_power = 16.0;
+// The smallest sum of the weights of the neighbors for which the old color is on the same surface as the neighbors.
+const float min_weight_sum = 0.5;
+// The weight of the old color of the pixel when it is on the same surface as the neighbors.
+const float old_color_weight = 0.5;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+// The reconstructed color.
+layout (location = 0) out vec4 final_color;
+
+// ----------------------------------------------------------------------------
+// Local Methods
+// ----------------------------------------------------------------------------
+
+// Converts the depth written by HandleDepth in ray_tracing.frag back to the distance from the eye.
+float DepthToDistance(float depth)
+{
+	float near = projection[3][2] / (projection[2][2] - 1.0f);
+	float far = projection[3][2] / (projection[2][2] + 1.0f);
+	return 1.0 / (1.0 / near + depth * (1.0 / far - 1.0 / near));
+}
+
+// Returns the weight of the neighbor decreasing with its distance from the surface of the reference pixel and with the
+// angle between their normals (the normals of the missed rays are zero, two misses are on the same surface).
+float EdgeStoppingWeight(float reference_distance, vec3 reference_normal, float distance, vec3 normal)
+{
+	float distance_weight = max(1.0 - abs(distance - reference_distance) / (max_distance_difference * reference_distance), 0.0);
+	float normal_weight = reference_normal == normal ? 1.0 : pow(max(dot(reference_normal, normal), 0.0), normal_power);
+	return distance_weight * normal_weight;
+}
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec3 old_color = texelFetch(traced_color_texture, pixel, 0).rgb;
+	float old_depth = texelFetch(traced_depth_texture, pixel, 0).r;
+	if (IsPixelTraced(pixel)) {
+		final_color = vec4(old_color, 1.0);
+		gl_FragDepth = old_depth;
+		return;
+	}
+
+	// Gathers the neighbors traced in the current frame (at least one pixel of every 2x2 block is traced).
+	ivec2 max_pixel = ivec2(resolution) - 1;
+	vec3 colors[8];
+	vec3 normals[8];
+	float distances[8];
+	float depths[8];
+	int count = 0;
+	int nearest = 0;
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			ivec2 neighbor = pixel + ivec2(x, y);
+			if (neighbor != clamp(neighbor, ivec2(0), max_pixel) || !IsPixelTraced(neighbor))
+				continue;
+
+			colors[count] = texelFetch(traced_color_texture, neighbor, 0).rgb;
+			normals[count] = texelFetch(traced_normal_texture, neighbor, 0).xyz;
+			depths[count] = texelFetch(traced_depth_texture, neighbor, 0).r;
+			distances[count] = DepthToDistance(depths[count]);
+			nearest = distances[count] < distances[nearest] ? count : nearest;
+			count++;
+		}
+	}
+	if (count == 0) {
+		final_color = vec4(old_color, 1.0);
+		gl_FragDepth = old_depth;
+		return;
+	}
+
+	// Interpolates the neighbors on the surface last traced in the pixel. If the surface is still there, the old color
+	// is kept as well, clamped into the colors of the neighbors (the lighting may have changed since it was traced).
+	float old_distance = DepthToDistance(old_depth);
+	vec3 old_normal = texelFetch(traced_normal_texture, pixel, 0).xyz;
+	vec3 color_sum = vec3(0.0);
+	float weight_sum = 0.0;
+	vec3 color_min = colors[0];
+	vec3 color_max = colors[0];
+	for (int n = 0; n < count; n++) {
+		float weight = EdgeStoppingWeight(old_distance, old_normal, distances[n], normals[n]);
+		color_sum += weight * colors[n];
+		weight_sum += weight;
+		color_min = min(color_min, colors[n]);
+		color_max = max(color_max, colors[n]);
+	}
+	if (weight_sum >= min_weight_sum) {
+		final_color = vec4(mix(color_sum / weight_sum, clamp(old_color, color_min, color_max), old_color_weight), 1.0);
+		gl_FragDepth = old_depth;
+		return;
+	}
+
+	// Otherwise, the surface moved or it was disoccluded; the pixel is interpolated from the neighbors on the surface of
+	// the nearest neighbor, which hides the surfaces behind it.
+	color_sum = vec3(0.0);
+	weight_sum = 0.0;
+	for (int n = 0; n < count; n++) {
+		float weight = EdgeStoppingWeight(distances[nearest], normals[nearest], distances[n], normals[n]);
+		color_sum += weight * colors[n];
+		weight_sum += weight;
+	}
+	final_color = vec4(color_sum / weight_sum, 1.0);
+	gl_FragDepth = depths[nearest];
+}
@@ -0,0 +1,24 @@
+// ----------------------------------------------------------------------------
+// Interleaved Rendering
+// ----------------------------------------------------------------------------
+// The pixels traced in one frame of the interleaved rendering, the others keep the colors traced in the previous frames
+// and they are reconstructed by interleaved_reconstruction.frag. With the period 2, the traced pixels form a checkerboard
+// whose colors alternate; with the period 4, one pixel of every 2x2 block is traced in each frame.
+
+// The number of frames in which every pixel is traced once (1 traces all pixels in every frame).
+uniform int interleaving_period;
+// The index of the current frame in the period.
+uniform int interleaving_phase;
+
+// The order of the pixels of the 2x2 block with the period 4 (x + 2 * y), the successive pixels are diagonal.
+const int quarter_order[4] = int[4](0, 3, 1, 2);
+
+// Checks if the pixel is traced in the current frame.
+bool IsPixelTraced(ivec2 pixel)
+{
+	if (interleaving_period == 2)
+		return ((pixel.x + pixel.y + interleaving_phase) & 1) == 0;
+	if (interleaving_period == 4)
+		return (pixel.x & 1) + 2 * (pixel.y & 1) == quarter_order[interleaving_phase];
+	return true;
+}
@@ -47,32 +47,27 @@ layout (std140, binding = 2) LIGHTS_STORAGE PhongLightsBuffer
 	PhongLight lights[LIGHTS_MAX_COUNT];    // The array with actual lights.
 };
 
-// The material data.
-layout (std140, binding = 3) uniform PhongMaterialBuffer
+// The structure holding the information about a single Phong material.
+struct PhongMaterial
 {
 	vec3 ambient;     // The ambient part of the material.
 	vec3 diffuse;     // The diffuse part of the material.
 	float alpha;      // The alpha (transparency) of the material.
 	vec3 specular;    // The specular part of the material.
 	float shininess;  // The shininess of the material.
-} material;
-
-struct PBRMaterialData{
-	/** The diffuse color of the material. */
-	vec3 diffuse;
-	/** The roughness of the material. */
-	float roughness;
-	/** The Fresnel reflection at 0. */
-	vec3 f0;
 };
 
-const int snowman_sphere_count = 13;
-
-layout (std140, binding = 4) uniform Snowman
+// The materials of all rasterized instances.
+layout (std430, binding = 8) readonly buffer PhongMaterialBuffer
 {
-	vec4 positions[snowman_sphere_count];
-	PBRMaterialData materials[snowman_sphere_count];
-} snowman;
+	PhongMaterial materials[];
+};
+
+// The index of the material of the instance.
+flat in int material_index;
+
+#pragma include spheres.glsl
+#pragma include rectangular_lights.glsl
 
 // The flag determining whether a texture should be used.
 uniform bool has_texture;
@@ -86,39 +81,10 @@ layout(binding = 0) uniform sampler2D material_diffuse_texture;
 // The final output color.
 layout (location = 0) out vec4 final_color;
 
-float sphere_occlusion(vec3 position, vec3 normal, vec4 sphere)
-{
-	// taken from https://www.shadertoy.com/view/4djSDy
-	vec3 di = sphere.xyz - position;
-	float l  = length(di);
-	float nl = dot(normal, di / l);
-	float h  = l / sphere.w;
-	float h2 = h * h;
-	float k2 = 1.0 - h2 * nl * nl;
-
-	// above or below the hemisphere
-	float res = max(0.0, nl) / h2;
-
-	// intersecting the hemisphere
-	if(k2 > 0.0) {
-		res = (nl * h + 1.0)/h2;
-		res = 0.33 * res * res;
-	}
-
-	return res;
-}
-
-float occlude_ambient(vec3 position, vec3 normal)
-{
-	float occlusion = 0.0f;
-	for (int i = 0; i < snowman_sphere_count; ++i) {
-		occlusion += sphere_occlusion(position, normal, snowman.positions[i]);
-	}
-	return 1.0f - occlusion;
-}
-
 void main()
 {
+	PhongMaterial material = materials[material_index];
+
 	// Computes the lighting.
 	vec3 N = normalize(in_data.normal_ws);
 	vec3 V = normalize(eye_position - in_data.position_ws);
@@ -177,6 +143,12 @@ void main()
 		spe += Ispe * lights[i].specular;
 	}
 
+	// Adds the diffuse light of the rectangular lights (without shadows).
+	for (int r = 0; r < rectangular_lights_count; r++)
+	{
+		dif += rectangular_light_form_factor(rectangular_lights[r], in_data.position_ws, N) * rectangular_lights[r].radiance.rgb;
+	}
+
 	// Computes the material - we either use material or texture as ambient and diffuse parts.
 	vec3 mat_ambient = has_texture ? texture(material_diffuse_texture, in_data.tex_coord).rgb : material.ambient;
 	vec3 mat_diffuse = has_texture ? texture(material_diffuse_texture, in_data.tex_coord).rgb : material.diffuse;
@@ -0,0 +1,70 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+// The particle positions and the indices of the visible particles (six vertices are drawn per visible particle).
+#pragma include snow.glsl
+
+uniform float particle_size_vs;
+
+// The UBO with camera data.	
+layout (std140, binding = 0) uniform CameraData
+{
+	mat4 projection;		// The projection matrix.
+	mat4 projection_inv;	// The inverse of the projection matrix.
+	mat4 view;				// The view matrix
+	mat4 view_inv;			// The inverse of the view matrix.
+	mat3 view_it;			// The inverse of the transpose of the top-left part 3x3 of the view matrix
+	vec3 eye_position;		// The position of the eye in world space.
+};
+
+// ----------------------------------------------------------------------------
+// Local Variables
+// ----------------------------------------------------------------------------
+// The corners of the two triangles of the quad (indices into the arrays below, in the order of particle_textured.geom).
+const int quad_corners[6] = int[6](0, 1, 2, 2, 1, 3);
+// The texture coorinates of the corners.
+const vec2 quad_tex_coords[4] = vec2[4](
+	vec2(0.0, 1.0),
+	vec2(0.0, 0.0),
+	vec2(1.0, 1.0),
+	vec2(1.0, 0.0)
+);
+// The position offsets of the corners.
+const vec2 quad_offsets[4] = vec2[4](
+	vec2(-0.5, +0.5),
+	vec2(-0.5, -0.5),
+	vec2(+0.5, +0.5),
+	vec2(+0.5, -0.5)
+);
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+out VertexData
+{
+	vec2 tex_coord;    // The texture coordinates for the particle.
+} out_data;
+
+const float PI = 3.14159265359f;
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+// Expands the particles into quads without the geometry shader: the vertex pulls its particle from the buffers.
+void main()
+{
+	vec4 position = snow_positions[visible_indices[gl_VertexID / 6]];
+	int corner = quad_corners[gl_VertexID % 6];
+
+	// The same size and rotation as in particle_textured.vert, the rotation is applied as in particle_textured.geom.
+	float size = particle_size_vs * (position.w * 0.5f + 0.5f);
+	float angle = fract(position.w * 7.31f) * 2 * PI;
+	vec2 offset = quad_offsets[corner];
+	vec2 rotated_offset = vec2(offset.x * cos(angle) + offset.y * sin(angle), -offset.x * sin(angle) + offset.y * cos(angle));
+
+	vec4 position_vs = view * vec4(position.xyz, 1.0f);
+	out_data.tex_coord = quad_tex_coords[corner];
+	gl_Position = projection * (position_vs + vec4(size * rotated_offset, 0.0f, 0.0f));
+}
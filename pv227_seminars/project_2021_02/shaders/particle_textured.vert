@@ -3,11 +3,10 @@
 // ----------------------------------------------------------------------------
 // Input Variables
 // ----------------------------------------------------------------------------
-// The particle position.
-layout (location = 0) in vec4 start_position;
+// The particle positions and the indices of the visible particles (one vertex is drawn per visible particle).
+#pragma include snow.glsl
 
 uniform float particle_size_vs;
-uniform float time;
 
 // The UBO with camera data.	
 layout (std140, binding = 0) uniform CameraData
@@ -32,24 +31,14 @@ out VertexData
 
 const float PI = 3.14159265359f;
 
-float hash13(vec3 p3)
-{
-	p3  = fract(p3 * .1031);
-    p3 += dot(p3, p3.zyx + 31.32);
-    return fract((p3.x + p3.y) * p3.z);
-}
-
 // ----------------------------------------------------------------------------
 // Main Method
 // ----------------------------------------------------------------------------
 void main()
 {
-	float size_factor = hash13(start_position.xyz) * 0.5f + 0.5f;
-	out_data.particle_size_vs = particle_size_vs * size_factor;
-	out_data.particle_rotation_vs = hash13(start_position.xyz) * 2 * PI;
-
-	vec4 new_position = start_position;
-	new_position.y -= time * 0.001f;
-	new_position.y = mod(new_position.y, 60.0f) - 1.0f;
-	out_data.position_vs = view * new_position;
-}
\ No newline at end of file
+	// The particles are moved by snow_simulate.comp, their random value determines their size and rotation.
+	vec4 position = snow_positions[visible_indices[gl_VertexID]];
+	out_data.particle_size_vs = particle_size_vs * (position.w * 0.5f + 0.5f);
+	out_data.particle_rotation_vs = fract(position.w * 7.31f) * 2 * PI;
+	out_data.position_vs = view * vec4(position.xyz, 1.0f);
+}
@@ -0,0 +1,495 @@
+// ----------------------------------------------------------------------------
+// Ray Tracing
+// ----------------------------------------------------------------------------
+// The scene, the intersections and the lighting shared by the ray tracing in the fragment shader (ray_tracing.frag)
+// and by the stages of the wavefront ray tracing (wavefront_*.comp).
+
+// The UBO with camera data.	
+layout (std140, binding = 0) uniform CameraBuffer
+{
+	mat4 projection;	  // The projection matrix.
+	mat4 projection_inv;  // The inverse of the projection matrix.
+	mat4 view;			  // The view matrix
+	mat4 view_inv;		  // The inverse of the view matrix.
+	mat3 view_it;		  // The inverse of the transpose of the top-left part 3x3 of the view matrix
+	vec3 eye_position;	  // The position of the eye in world space.
+};
+
+// The structure holding the information about a single Phong light.
+struct PhongLight
+{
+	vec4 position;                   // The position of the light. Note that position.w should be one for point lights and spot lights, and zero for directional lights.
+	vec3 ambient;                    // The ambient part of the color of the light.
+	vec3 diffuse;                    // The diffuse part of the color of the light.
+	vec3 specular;                   // The specular part of the color of the light. 
+	vec3 spot_direction;             // The direction of the spot light, irrelevant for point lights and directional lights.
+	float spot_exponent;             // The spot exponent of the spot light, irrelevant for point lights and directional lights.
+	float spot_cos_cutoff;           // The cosine of the spot light's cutoff angle, -1 point lights, irrelevant for directional lights.
+	float atten_constant;            // The constant attenuation of spot lights and point lights, irrelevant for directional lights. For no attenuation, set this to 1.
+	float atten_linear;              // The linear attenuation of spot lights and point lights, irrelevant for directional lights.  For no attenuation, set this to 0.
+	float atten_quadratic;           // The quadratic attenuation of spot lights and point lights, irrelevant for directional lights. For no attenuation, set this to 0.
+};
+
+// The UBO with light data.
+layout (std140, binding = 2) uniform PhongLightsBuffer
+{
+	vec3 global_ambient_color;		// The global ambient color.
+	int lights_count;				// The number of lights in the buffer.
+	PhongLight lights[8];			// The array with actual lights.
+};
+
+#pragma include spheres.glsl
+#pragma include noise.glsl
+#pragma include rectangular_lights.glsl
+
+// The windows size.
+uniform vec2 resolution;
+// The number of iterations.
+uniform int iterations;
+
+uniform int shadow_samples;
+
+uniform bool use_ambient_occlusion;
+
+uniform float sphere_light_radius;
+
+// The flag determining if the shadows of the spherical lights should be computed analytically instead of by shadow rays.
+uniform bool use_analytic_shadows;
+
+// The index of the frame; it changes the shadow samples in every frame so that they can be accumulated over time.
+uniform int frame_index;
+
+// The flag determining if the shadow samples should be taken from blue_noise_in_disk instead of the hash.
+uniform bool use_blue_noise;
+
+// The flag determining if the hits should be classified by a few probe rays first, so that only the hits in the
+// penumbra are sampled by all shadow samples.
+uniform bool use_adaptive_shadows;
+
+// The flag determining if the path should stop when its throughput (attenuation) cannot contribute visibly.
+uniform bool use_throughput_cutoff;
+// The flag determining if the paths with a low throughput should be randomly terminated (Russian roulette).
+uniform bool use_russian_roulette;
+
+// The blue noise texture that rotates the samples from blue_noise_in_disk differently in every pixel.
+layout (binding = 0) uniform sampler2D blue_noise_texture;
+
+// ----------------------------------------------------------------------------
+// Ray Tracing Structures
+// ----------------------------------------------------------------------------
+// The definition of a ray.
+struct Ray {
+    vec3 origin;     // The ray origin.
+    vec3 direction;  // The ray direction.
+	int light_mask;
+};
+// The definition of an intersection.
+struct Hit {
+    float t;				  // The distance between the ray origin and the intersection points along the ray. 
+	vec3 intersection;        // The intersection point.
+    vec3 normal;              // The surface normal at the interesection point.
+	PBRMaterialData material; // The material of the object at the intersection point.
+	int light_index;
+};
+const Hit miss = Hit(1e20, vec3(0.0), vec3(0.0), PBRMaterialData(vec3(0),0,vec3(0)), -1);
+
+const float epsilon = 1e-2;
+const float PI = 3.14159265359f;
+
+// The number of probe rays classifying the hits in the adaptive shadows (the center of the light and its rim).
+const int shadow_probe_count = 5;
+// The radius of the rim probes relative to the radius of the light.
+const float shadow_probe_radius = 0.95;
+
+// The throughput below which the path is stopped by the cutoff (the contribution is below the 8-bit precision).
+const float min_throughput = 1e-3;
+// The throughput below which the paths enter the Russian roulette; the survivors are boosted back to this throughput.
+const float russian_roulette_throughput = 0.1;
+
+// ----------------------------------------------------------------------------
+// Ray Tracing Methods
+// ----------------------------------------------------------------------------
+
+// The FresnelSchlick approximation of the reflection.
+vec3 FresnelSchlick(in vec3 f0, in vec3 V, in vec3 H)
+{
+	float VdotH = clamp(dot(V, H), 0.0, 1.0);
+	return f0 + (1.0 - f0) * pow(1.0 - VdotH, 5.0);
+}
+
+// Computes an intersection between a ray and a sphere defined by its center and radius.
+// ray - the ray definition (contains ray.origin and ray.direction)
+// center - the center of the sphere
+// radius - the radius of the sphere
+// i - the index of the sphere in the array, can be used to obtain the material from materials buffer
+Hit RaySphereIntersection(Ray ray, vec3 center, float radius, int i, bool is_snowman) {
+
+	// Optimalized version.
+	vec3 oc = ray.origin - center;
+	float b = dot(ray.direction, oc);
+	float c = dot(oc, oc) - (radius*radius);
+
+	float det = b*b - c;
+	if (det < 0.0) return miss;
+
+	float t = -b - sqrt(det);
+	if (t < 0.0) t = -b + sqrt(det);
+	if (t < 0.0) return miss;
+
+	vec3 intersection = ray.origin + t * ray.direction;
+	vec3 normal = normalize(intersection - center);
+	if (is_snowman) {
+		return Hit(t, intersection, normal, sphere_materials[i], -1);
+	} else {
+		PBRMaterialData light_material = { lights[i].diffuse, 0.0f, vec3(0) };
+		return Hit(t, intersection, normal, light_material, i);
+	}
+}
+
+// Computes an intersection between a ray and a plane defined by its normal and one point inside the plane.
+// ray - the ray definition (contains ray.origin and ray.direction)
+// normal - the plane normal
+// point - a point laying in the plane
+Hit RayPlaneIntersection(Ray ray, vec3 normal, vec3 point) {
+	float nd = dot(normal, ray.direction);
+	vec3 sp = point - ray.origin;
+	float t = dot(sp, normal) / nd;
+    if (t < 0.0) return miss;
+
+	vec3 intersection = ray.origin + t * ray.direction;
+	
+	if(intersection.x > 100 || intersection.x < -100 || intersection.z > 100 || intersection.z < -100)
+		return miss;
+
+    return Hit(t, intersection, normal, sphere_materials[0], -1);
+}
+
+// Computes an intersection between a ray and the emitting side of a rectangular light.
+// r - the index of the light in the rectangular lights buffer
+Hit RayRectangleIntersection(Ray ray, int r) {
+	RectangularLight light = rectangular_lights[r];
+	vec3 normal = normalize(cross(light.half_u.xyz, light.half_v.xyz));
+	float nd = dot(normal, ray.direction);
+	if (nd >= 0.0) return miss;
+
+	float t = dot(light.center.xyz - ray.origin, normal) / nd;
+	if (t < 0.0) return miss;
+
+	vec3 intersection = ray.origin + t * ray.direction;
+	vec3 offset = intersection - light.center.xyz;
+	if (abs(dot(offset, light.half_u.xyz)) > dot(light.half_u.xyz, light.half_u.xyz)
+		|| abs(dot(offset, light.half_v.xyz)) > dot(light.half_v.xyz, light.half_v.xyz))
+		return miss;
+
+	PBRMaterialData light_material = { light.radiance.rgb, 0.0f, vec3(0) };
+	return Hit(t, intersection, normal, light_material, lights_count + r);
+}
+
+// Checks if a ray intersects a box closer than max_t.
+bool RayBoxIntersection(Ray ray, vec3 inv_direction, vec3 bounds_min, vec3 bounds_max, float max_t) {
+	vec3 t1 = (bounds_min - ray.origin) * inv_direction;
+	vec3 t2 = (bounds_max - ray.origin) * inv_direction;
+	vec3 t_min = min(t1, t2);
+	vec3 t_max = max(t1, t2);
+	float t_near = max(max(t_min.x, t_min.y), max(t_min.z, 0.0));
+	float t_far = min(min(t_max.x, t_max.y), t_max.z);
+	return t_near <= t_far && t_near < max_t;
+}
+
+// Returns the closer of the hit and the intersections of the ray with the lights.
+Hit EvaluateLights(Ray ray, Hit closest_hit){
+	for(int i = 0; i < lights_count; i++){
+		if ((ray.light_mask & (1 << i)) == 0) {
+			continue;
+		}
+		vec3 center = lights[i].position.xyz / lights[i].position.w;
+		Hit intersection = RaySphereIntersection(ray, center, sphere_light_radius + epsilon, i, false);
+		if(intersection.t < closest_hit.t){
+			closest_hit = intersection;
+		}
+	}
+
+	// The rectangular lights are seen only by the primary and the reflected rays, they do not cast shadows.
+	if (ray.light_mask == -1) {
+		for (int r = 0; r < rectangular_lights_count; r++) {
+			Hit intersection = RayRectangleIntersection(ray, r);
+			if (intersection.t < closest_hit.t) {
+				closest_hit = intersection;
+			}
+		}
+	}
+
+    return closest_hit;
+}
+
+// Evaluates the intersections of the ray with the scene objects and returns the closes hit.
+Hit Evaluate(Ray ray){
+	// Sets the closes hit either to miss or to an intersection with the plane representing the ground.
+	Hit closest_hit = RayPlaneIntersection(ray, vec3(0, 1, 0), vec3(0));
+
+	// Traverses the BVH over the snowman spheres, the nearer child is visited first.
+	vec3 inv_direction = 1.0 / ray.direction;
+	int stack[bvh_max_depth];
+	int stack_size = 0;
+	int node_index = 0;
+	while (true) {
+		BVHNode node = bvh_nodes[node_index];
+		if (RayBoxIntersection(ray, inv_direction, node.bounds_min, node.bounds_max, closest_hit.t)) {
+			if (node.count >= 0) {
+				for (int k = node.first; k < node.first + node.count; k++) {
+					int i = bvh_indices[k];
+					Hit intersection = RaySphereIntersection(ray, sphere_positions[i].xyz, sphere_positions[i].w, i, true);
+					if(intersection.t < closest_hit.t){
+						closest_hit = intersection;
+					}
+				}
+			} else {
+				bool negative = ray.direction[-1 - node.count] < 0.0;
+				stack[stack_size++] = negative ? node_index + 1 : node.first;
+				node_index = negative ? node.first : node_index + 1;
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+
+	return EvaluateLights(ray, closest_hit);
+}
+
+// Returns the depth of the hit of the ray as written by the rasterization with the camera projection (1 for a miss).
+float HitDepth(Hit hit, Ray ray)
+{
+	if (hit == miss) {
+		return 1.0f;
+	}
+	float d = length(hit.intersection - ray.origin);
+	float near = projection[3][2] / (projection[2][2] - 1.0f);
+	float far = projection[3][2] / (projection[2][2] + 1.0f);
+	return (1 / d - 1 / near) / (1 / far - 1 / near);
+}
+
+vec2 hash23(vec3 p3)
+{
+	p3 = fract(p3 * vec3(.1031, .1030, .0973));
+    p3 += dot(p3, p3.yzx+33.33);
+    return fract((p3.xx+p3.yz)*p3.zy);
+}
+
+// Returns the sample_index-th sample from blue_noise_in_disk rotated for the pixel, light, and frame.
+// The per-pixel rotations from the blue noise texture turn the errors of the few samples into a high-frequency noise
+// that is hardly visible; the golden ratio sequence scrambles the rotations in every frame, so they can be accumulated.
+vec2 BlueNoiseInDisk(ivec2 pixel, int light, int sample_index)
+{
+	float noise = texelFetch(blue_noise_texture, pixel % textureSize(blue_noise_texture, 0), 0)[light % 4];
+	float angle = fract(noise + 0.61803398875 * float(frame_index)) * 2.0 * PI;
+	// More samples than in the table repeat the table rotated by the golden angle.
+	angle += float(sample_index / 64) * 2.39996323;
+
+	vec2 p = blue_noise_in_disk[sample_index % 64];
+	float c = cos(angle);
+	float s = sin(angle);
+	return vec2(c * p.x - s * p.y, s * p.x + c * p.y);
+}
+
+// Returns the direction towards a point of the spherical light; the point is in the disk perpendicular to L (the unit
+// direction towards the light center) and it is scaled by the angular radius of the light.
+vec3 LightDiskDirection(vec3 L, vec2 point_on_disk)
+{
+	vec3 light_tangent = normalize(cross(L, vec3(0.0f, -1.0f, 0.0f)));
+	vec3 light_bitangent = normalize(cross(light_tangent, L));
+
+	return normalize(L + point_on_disk.x * light_tangent + point_on_disk.y * light_bitangent);
+}
+
+// Checks if the shadow ray from the hit in the direction reaches the i-th light.
+bool ShadowRayReachesLight(Hit hit, vec3 ray_dir, int i)
+{
+	Ray shadow_ray = Ray(hit.intersection + epsilon * ray_dir, ray_dir, 1 << i);
+	Hit shadow_hit = Evaluate(shadow_ray);
+
+	return shadow_hit.light_index == i;
+}
+
+// Computes the light of the i-th spherical light reflected by the hit, the shadows are either sampled by the shadow rays
+// or computed analytically. The pixel rotates the blue noise samples.
+vec3 SphereLightContribution(Hit hit, int i, ivec2 pixel, vec3 fresnel, vec3 attenuation)
+{
+	vec3 reflectance = lights[i].diffuse
+		* hit.material.diffuse
+		* (1.0 - fresnel)
+		* attenuation
+		/ lights_count;
+
+	if (use_analytic_shadows)
+	{
+		// One noise-free evaluation instead of the shadow rays (see sphere_light_visibility).
+		vec3 light_center = lights[i].position.xyz / lights[i].position.w;
+		vec3 L = normalize(light_center - hit.intersection);
+		float visibility = sphere_light_visibility(hit.intersection, light_center, sphere_light_radius);
+		return max(dot(hit.normal, L), 0.0) * visibility * reflectance;
+	}
+
+	// Classifies the hit by the probe rays towards the center and the rim of the light. If they all agree, the hit
+	// is fully lit or in the umbra and the probes are enough, the full number of samples is spent only in the penumbra.
+	if (use_adaptive_shadows && shadow_samples > shadow_probe_count)
+	{
+		vec3 L = lights[i].position.xyz / lights[i].position.w - hit.intersection;
+		float light_radius = sphere_light_radius / length(L);
+		float rotation = hash23(L).x * 2 * PI;
+		L = normalize(L);
+
+		int visible_probes = 0;
+		float lit = 0.0;
+		for (int p = 0; p < shadow_probe_count; p++)
+		{
+			float angle = rotation + float(p) * 2 * PI / float(shadow_probe_count - 1);
+			vec2 point_on_disk = p == 0 ? vec2(0.0) : shadow_probe_radius * light_radius * vec2(cos(angle), sin(angle));
+			vec3 ray_dir = LightDiskDirection(L, point_on_disk);
+			if (ShadowRayReachesLight(hit, ray_dir, i))
+			{
+				visible_probes++;
+				lit += max(dot(hit.normal, ray_dir), 0.0);
+			}
+		}
+
+		if (visible_probes == 0)
+		{
+			return vec3(0.0);
+		}
+		if (visible_probes == shadow_probe_count)
+		{
+			return lit / shadow_probe_count * reflectance;
+		}
+	}
+
+	float lit = 0.0;
+	for (int j = 0; j < shadow_samples; j++)
+	{
+
+		vec3 L = lights[i].position.xyz / lights[i].position.w - hit.intersection;
+		
+		vec2 point_on_disk = vec2(0.0f);
+
+		float light_radius = sphere_light_radius / length(L);
+
+		if (use_blue_noise)
+		{
+			point_on_disk = BlueNoiseInDisk(pixel, i, j) * light_radius;
+		}
+		else
+		{
+			vec3 toHash = vec3(hash23(L), float(j + frame_index * shadow_samples));
+			vec2 hash = hash23(toHash);
+
+			float radius = sqrt(hash.x) * light_radius;
+			float angle = hash.y * 2 * PI;
+
+			point_on_disk.x = radius * cos(angle);
+			point_on_disk.y = radius * sin(angle);
+		}
+
+		vec3 ray_dir = LightDiskDirection(normalize(L), point_on_disk);
+
+		if (ShadowRayReachesLight(hit, ray_dir, i)) 
+		{
+			lit += max(dot(hit.normal, ray_dir), 0.0);
+		}
+	}
+	return lit / shadow_samples * reflectance;
+}
+
+// Computes the fraction of the light of the rectangular light that reaches the hit. The shadow rays are stratified over
+// the rectangle and weighted by the unshadowed integrand (the ratio estimator), hence the shading itself stays
+// analytic and noise-free and only the shadows are estimated by the rays.
+float RectangularLightVisibility(Hit hit, int r)
+{
+	RectangularLight light = rectangular_lights[r];
+	vec3 light_normal = normalize(cross(light.half_u.xyz, light.half_v.xyz));
+
+	// The samples are jittered in the cells of a grid that is as square as possible.
+	int columns = max(1, int(sqrt(float(shadow_samples))));
+	int rows = (shadow_samples + columns - 1) / columns;
+	vec2 seed = hash23(hit.intersection - light.center.xyz);
+
+	float visible = 0.0;
+	float total = 0.0;
+	for (int j = 0; j < shadow_samples; j++)
+	{
+		vec2 jitter = hash23(vec3(seed, float(j + frame_index * shadow_samples)));
+		vec2 uv = (vec2(j % columns, j / columns) + jitter) / vec2(columns, rows);
+
+		vec3 to_light = rectangular_light_point(light, uv) - hit.intersection;
+		float light_distance = length(to_light);
+		vec3 ray_dir = to_light / light_distance;
+		float weight = max(dot(hit.normal, ray_dir), 0.0) * max(dot(light_normal, -ray_dir), 0.0) / (light_distance * light_distance);
+		if (weight <= 0.0) {
+			continue;
+		}
+
+		// Only the ground and the spheres occlude the light.
+		Ray shadow_ray = Ray(hit.intersection + epsilon * ray_dir, ray_dir, 0);
+		Hit shadow_hit = Evaluate(shadow_ray);
+
+		total += weight;
+		if (shadow_hit.t >= light_distance - 2.0 * epsilon) {
+			visible += weight;
+		}
+	}
+	return total > 0.0 ? visible / total : 1.0;
+}
+
+// Computes the light of the r-th rectangular light reflected by the hit: the analytic unshadowed light multiplied by the
+// visibility.
+vec3 RectangularLightContribution(Hit hit, int r, vec3 fresnel, vec3 attenuation)
+{
+	float form_factor = rectangular_light_form_factor(rectangular_lights[r], hit.intersection, hit.normal);
+	if (form_factor <= 0.0)
+	{
+		return vec3(0.0);
+	}
+	return form_factor
+		* RectangularLightVisibility(hit, r)
+		* rectangular_lights[r].radiance.rgb
+		* hit.material.diffuse
+		* (1.0 - fresnel)
+		* attenuation;
+}
+
+// Stops the paths whose remaining bounces cannot contribute visibly, returns false if the path stops after the bounce.
+// The Russian roulette keeps such path with the probability proportional to its throughput and divides the throughput
+// by it, hence it stays unbiased.
+bool ContinuePath(inout vec3 attenuation, vec3 position, int bounce)
+{
+	float throughput = max(attenuation.r, max(attenuation.g, attenuation.b));
+	if (use_russian_roulette)
+	{
+		float survival = min(throughput / russian_roulette_throughput, 1.0);
+		if (hash23(vec3(hash23(position), float(bounce + frame_index * iterations))).x >= survival)
+		{
+			return false;
+		}
+		attenuation /= survival;
+		return true;
+	}
+	return !use_throughput_cutoff || throughput >= min_throughput;
+}
+
+// Returns the primary ray through the point of the screen with the texture coordinates (in [0, 1]^2).
+Ray CameraRay(vec2 tex_coord)
+{
+	// The aspect ratio.
+	// It tells us how many times the window is wider (or narrower) w.r.t. its height.
+	float aspect_ratio = resolution.x/resolution.y;
+
+	// We use the texture coordinates and the aspect ratio to map the coordinates to the screen space.
+	vec2 uv = (2.0*tex_coord - 1.0) * vec2(aspect_ratio, 1.0);
+	//vec2 uv = (2.0*gl_FragCoord.xy / resolution.xy - 1.0) * vec2(aspect_ratio, 1.0);
+
+	// Computes the ray origin and ray direction using the view matrix.
+	vec3 P = vec3(view_inv * vec4(uv, -1.0, 1.0));
+	vec3 direction = normalize(P - eye_position);
+	return Ray(eye_position, direction, -1);
+}
@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+// Rectangular Lights
+// ----------------------------------------------------------------------------
+// The declarations of the rectangular area lights (see rectangular_light.hpp) shared by the ray tracing and the
+// rasterization shaders.
+
+// The structure holding the information about a single rectangular light.
+struct RectangularLight
+{
+	vec4 center;	// The center of the rectangle (w is unused).
+	vec4 half_u;	// The half of the first edge of the rectangle (w is unused).
+	vec4 half_v;	// The half of the second edge of the rectangle (w is unused), the light emits towards cross(half_u, half_v).
+	vec4 radiance;	// The emitted radiance (w is unused).
+};
+
+// The rectangular lights.
+layout (std430, binding = 13) readonly buffer RectangularLightsBuffer
+{
+	RectangularLight rectangular_lights[];
+};
+
+// The number of the rectangular lights that are used.
+uniform int rectangular_lights_count;
+
+// ----------------------------------------------------------------------------
+// Linearly Transformed Cosines
+// ----------------------------------------------------------------------------
+// The integration of a polygon over a linearly transformed cosine distribution, see Heitz et al. 2016, "Real-Time
+// Polygonal-Light Shading with Linearly Transformed Cosines". The polygon is transformed by the inverse matrix of the
+// distribution, which turns the distribution into the clamped cosine whose integral over a polygon is analytic.
+
+// Integrates the normalized clamped cosine over the spherical edge between two unit vectors (the result is a vector, its
+// z coordinate is the contribution of the edge); the fitted rational function avoids the imprecise acos and includes
+// the normalization by 1/(2 pi).
+vec3 ltc_integrate_edge(vec3 v1, vec3 v2)
+{
+	float x = dot(v1, v2);
+	float y = abs(x);
+	float a = 0.8543985 + (0.4965155 + 0.0145206 * y) * y;
+	float b = 3.4175940 + (4.1616724 + y) * y;
+	float v = a / b;
+	float theta_sin_theta = (x > 0.0) ? v : 0.5 * inversesqrt(max(1.0 - x * x, 1e-7)) - v;
+	return cross(v1, v2) * theta_sin_theta;
+}
+
+// Clips the quad to the upper hemisphere (z > 0); n is the number of the remaining vertices (0, 3, 4, or 5).
+void ltc_clip_quad_to_horizon(inout vec3 L[5], out int n)
+{
+	// The vertices above the horizon.
+	int config = 0;
+	if (L[0].z > 0.0) config += 1;
+	if (L[1].z > 0.0) config += 2;
+	if (L[2].z > 0.0) config += 4;
+	if (L[3].z > 0.0) config += 8;
+
+	// The new vertices are the intersections of the edges with the horizon (not normalized).
+	n = 0;
+	if (config == 1) { // V1 clip V2 V3 V4
+		n = 3;
+		L[1] = -L[1].z * L[0] + L[0].z * L[1];
+		L[2] = -L[3].z * L[0] + L[0].z * L[3];
+	} else if (config == 2) { // V2 clip V1 V3 V4
+		n = 3;
+		L[0] = -L[0].z * L[1] + L[1].z * L[0];
+		L[2] = -L[2].z * L[1] + L[1].z * L[2];
+	} else if (config == 3) { // V1 V2 clip V3 V4
+		n = 4;
+		L[2] = -L[2].z * L[1] + L[1].z * L[2];
+		L[3] = -L[3].z * L[0] + L[0].z * L[3];
+	} else if (config == 4) { // V3 clip V1 V2 V4
+		n = 3;
+		L[0] = -L[3].z * L[2] + L[2].z * L[3];
+		L[1] = -L[1].z * L[2] + L[2].z * L[1];
+	} else if (config == 6) { // V2 V3 clip V1 V4
+		n = 4;
+		L[0] = -L[0].z * L[1] + L[1].z * L[0];
+		L[3] = -L[3].z * L[2] + L[2].z * L[3];
+	} else if (config == 7) { // V1 V2 V3 clip V4
+		n = 5;
+		L[4] = -L[3].z * L[0] + L[0].z * L[3];
+		L[3] = -L[3].z * L[2] + L[2].z * L[3];
+	} else if (config == 8) { // V4 clip V1 V2 V3
+		n = 3;
+		L[0] = -L[0].z * L[3] + L[3].z * L[0];
+		L[1] = -L[2].z * L[3] + L[3].z * L[2];
+		L[2] = L[3];
+	} else if (config == 9) { // V1 V4 clip V2 V3
+		n = 4;
+		L[1] = -L[1].z * L[0] + L[0].z * L[1];
+		L[2] = -L[2].z * L[3] + L[3].z * L[2];
+	} else if (config == 11) { // V1 V2 V4 clip V3
+		n = 5;
+		L[4] = L[3];
+		L[3] = -L[2].z * L[3] + L[3].z * L[2];
+		L[2] = -L[2].z * L[1] + L[1].z * L[2];
+	} else if (config == 12) { // V3 V4 clip V1 V2
+		n = 4;
+		L[1] = -L[1].z * L[2] + L[2].z * L[1];
+		L[0] = -L[0].z * L[3] + L[3].z * L[0];
+	} else if (config == 13) { // V1 V3 V4 clip V2
+		n = 5;
+		L[4] = L[3];
+		L[3] = L[2];
+		L[2] = -L[1].z * L[2] + L[2].z * L[1];
+		L[1] = -L[1].z * L[0] + L[0].z * L[1];
+	} else if (config == 14) { // V2 V3 V4 clip V1
+		n = 5;
+		L[4] = -L[0].z * L[3] + L[3].z * L[0];
+		L[0] = -L[0].z * L[1] + L[1].z * L[0];
+	} else if (config == 15) { // V1 V2 V3 V4
+		n = 4;
+	}
+	// The configurations 5 and 10 cannot happen for a planar quad, 0 is below the horizon.
+
+	// Closes the polygon.
+	if (n == 3) L[3] = L[0];
+	if (n == 4) L[4] = L[0];
+}
+
+// Integrates the distribution given by its inverse matrix Minv (in the frame of the normal) over the quad seen from the
+// position. The result is normalized, i.e., a quad covering the whole hemisphere gives one.
+float ltc_evaluate(vec3 position, vec3 normal, mat3 Minv, vec3 points[4])
+{
+	// The frame around the normal (the orientation around the normal does not matter for the isotropic distributions).
+	vec3 T1 = normalize(cross(normal, abs(normal.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+	vec3 T2 = cross(normal, T1);
+	Minv = Minv * transpose(mat3(T1, T2, normal));
+
+	vec3 L[5];
+	L[0] = Minv * (points[0] - position);
+	L[1] = Minv * (points[1] - position);
+	L[2] = Minv * (points[2] - position);
+	L[3] = Minv * (points[3] - position);
+	L[4] = L[3];
+
+	int n;
+	ltc_clip_quad_to_horizon(L, n);
+	if (n == 0) {
+		return 0.0;
+	}
+
+	// Projects the polygon onto the unit sphere and integrates its edges.
+	for (int i = 0; i < 5; i++) {
+		L[i] = normalize(L[i]);
+	}
+	vec3 sum = ltc_integrate_edge(L[0], L[1]) + ltc_integrate_edge(L[1], L[2]) + ltc_integrate_edge(L[2], L[3]);
+	if (n >= 4) sum += ltc_integrate_edge(L[3], L[4]);
+	if (n == 5) sum += ltc_integrate_edge(L[4], L[0]);
+
+	// The winding of the projected polygon depends on the side it is seen from, the emitting side is tested by the caller.
+	return abs(sum.z);
+}
+
+// Computes the form factor of the rectangular light at the position, i.e., the irradiance from a light of unit
+// radiance divided by pi. The diffuse surfaces reflect the cosine distribution, whose LTC matrix is the identity;
+// it is zero if the position is behind the light.
+float rectangular_light_form_factor(RectangularLight light, vec3 position, vec3 normal)
+{
+	vec3 center = light.center.xyz;
+	vec3 u = light.half_u.xyz;
+	vec3 v = light.half_v.xyz;
+	if (dot(position - center, cross(u, v)) <= 0.0) {
+		return 0.0;
+	}
+
+	vec3 points[4] = vec3[4](center - u - v, center + u - v, center + u + v, center - u + v);
+	return ltc_evaluate(position, normal, mat3(1.0), points);
+}
+
+// Returns the point of the rectangular light at the coordinates from [0,1]^2.
+vec3 rectangular_light_point(RectangularLight light, vec2 uv)
+{
+	return light.center.xyz + (2.0 * uv.x - 1.0) * light.half_u.xyz + (2.0 * uv.y - 1.0) * light.half_v.xyz;
+}
@@ -0,0 +1,59 @@
+// ----------------------------------------------------------------------------
+// Snow
+// ----------------------------------------------------------------------------
+// The state of the snow particles shared by the compute shaders that seed, simulate, and cull them (see snow_seed.comp,
+// snow_simulate.comp, and snow_cull.comp), and by particle_textured.vert and particle_quad.vert that draw the visible
+// particles.
+
+// The positions of the particles (xyz), w is a random value in [0, 1) that determines the size and rotation of the flake.
+layout (std430, binding = 9) buffer SnowPositions
+{
+	vec4 snow_positions[];
+};
+
+// The velocities of the particles (xyz, in units per second), w is unused.
+layout (std430, binding = 10) buffer SnowVelocities
+{
+	vec4 snow_velocities[];
+};
+
+// The indirect draw command of the visible particles (the layout of DrawArraysIndirectCommand); snow_cull.comp
+// appends the visible particles by incrementing the count by their vertices.
+layout (std430, binding = 11) buffer SnowDrawCommand
+{
+	uint vertex_count;	// The number of vertices of the visible particles.
+	uint instance_count;
+	uint first_vertex;
+	uint base_instance;
+};
+
+// The indices of the visible particles.
+layout (std430, binding = 12) buffer SnowVisibleIndices
+{
+	uint visible_indices[];
+};
+
+// The volume in which the snow falls; the particles leaving it on one side enter it on the other side.
+const vec3 snow_volume_min = vec3(-30.0, -1.0, -30.0);
+const vec3 snow_volume_size = vec3(60.0, 60.0, 60.0);
+
+// The speed at which the flakes fall in still air (in units per second).
+const float fall_speed = 1.0;
+
+// The number of invocations in one work group of the snow compute shaders.
+#define SNOW_GROUP_SIZE 256
+
+// The PCG hash (Jarzynski and Olano, Hash Functions for GPU Rendering, 2020).
+uint pcg_hash(uint value)
+{
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// Returns a random value in [0, 1) and advances the state.
+float random_float(inout uint state)
+{
+	state = pcg_hash(state);
+	return float(state) / 4294967296.0;
+}
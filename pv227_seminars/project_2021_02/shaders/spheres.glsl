@@ -0,0 +1,185 @@
+// ----------------------------------------------------------------------------
+// Spheres
+// ----------------------------------------------------------------------------
+// The declarations of the snowman field (see snowman.hpp and sphere_bvh.hpp) shared by the ray tracing and the
+// rasterization shaders.
+
+struct PBRMaterialData{
+	/** The diffuse color of the material. */
+	vec3 diffuse;
+	/** The roughness of the material. */
+	float roughness;
+	/** The Fresnel reflection at 0 degrees. */
+	vec3 f0;
+};
+
+// The spheres stored as (center, radius).
+layout (std430, binding = 3) readonly buffer SphereBuffer
+{
+	vec4 sphere_positions[];
+};
+
+// The respective materials for each sphere.
+layout (std430, binding = 4) readonly buffer SphereMaterialBuffer
+{
+	PBRMaterialData sphere_materials[];
+};
+
+// The node of the BVH over the spheres.
+struct BVHNode
+{
+	vec3 bounds_min; // The minimum corner of the bounding box.
+	int first;		 // The index of the first sphere index (leaf) or the index of the right child (inner node).
+	vec3 bounds_max; // The maximum corner of the bounding box.
+	int count;		 // The number of spheres (leaf), or -1 - split axis (inner node).
+};
+
+// The flattened BVH, the left child of an inner node immediately follows its parent.
+layout (std430, binding = 5) readonly buffer BVHNodes
+{
+	BVHNode bvh_nodes[];
+};
+
+// The indices of the spheres referenced by the leaves.
+layout (std430, binding = 6) readonly buffer BVHIndices
+{
+	int bvh_indices[];
+};
+
+// The maximum depth of the BVH (SphereBVH::max_depth).
+const int bvh_max_depth = 32;
+
+// The distance at which the spheres stop contributing to the ambient occlusion.
+uniform float occlusion_distance;
+
+// ----------------------------------------------------------------------------
+// Ambient occlusion
+// ----------------------------------------------------------------------------
+float sphere_occlusion(vec3 position, vec3 normal, vec4 sphere)
+{
+	// taken from https://www.shadertoy.com/view/4djSDy
+	vec3 di = sphere.xyz - position;
+	float l  = length(di);
+	float nl = dot(normal, di / l);
+	float h  = l / sphere.w;
+	float h2 = h * h;
+	float k2 = 1.0 - h2 * nl * nl;
+
+	// above or below the hemisphere
+	float res = max(0.0, nl) / h2;
+
+	// intersecting the hemisphere
+	if(k2 > 0.0) {
+		res = (nl * h + 1.0)/h2;
+		res = 0.33 * res * res;
+	}
+
+	// The contribution fades out towards the occlusion distance, hence the spheres behind it can be skipped without seams.
+	return res * (1.0 - smoothstep(0.5 * occlusion_distance, occlusion_distance, l));
+}
+
+float occlude_ambient(vec3 position, vec3 normal)
+{
+	// Visits only the BVH nodes closer than the occlusion distance.
+	float occlusion = 0.0f;
+	int stack[bvh_max_depth];
+	int stack_size = 0;
+	int node_index = 0;
+	while (true) {
+		BVHNode node = bvh_nodes[node_index];
+		vec3 to_box = max(max(node.bounds_min - position, position - node.bounds_max), 0.0);
+		if (dot(to_box, to_box) < occlusion_distance * occlusion_distance) {
+			if (node.count >= 0) {
+				for (int k = node.first; k < node.first + node.count; k++) {
+					occlusion += sphere_occlusion(position, normal, sphere_positions[bvh_indices[k]]);
+				}
+			} else {
+				stack[stack_size++] = node.first;
+				node_index = node_index + 1;
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+	return 1.0f - occlusion;
+}
+
+// ----------------------------------------------------------------------------
+// Soft shadows
+// ----------------------------------------------------------------------------
+// Returns the fraction of the cap of the light covered by the cap of an occluder. The caps are given by their angular
+// radii and the angle between their axes, the area of their intersection is approximated by the smoothstep of
+// Oat and Sander (Ambient Aperture Lighting, 2007).
+float cap_coverage(float light_angle, float occluder_angle, float angle_between)
+{
+	float delta = abs(light_angle - occluder_angle);
+	if (angle_between >= light_angle + occluder_angle)
+		return 0.0;
+
+	// The area of the smaller cap relative to the light cap (the caps have the area 2 * PI * (1 - cos(angle))).
+	float smaller = light_angle <= occluder_angle ? 1.0 : (1.0 - cos(occluder_angle)) / max(1.0 - cos(light_angle), 1e-7);
+	if (angle_between <= delta)
+		return smaller;
+	return smaller * smoothstep(0.0, 1.0, 1.0 - (angle_between - delta) / (light_angle + occluder_angle - delta));
+}
+
+// Computes the fraction of the spherical light visible from the position. Since all occluders are spheres, the
+// visibility is computed analytically from the overlaps of the solid angles of the light and the occluders.
+float sphere_light_visibility(vec3 position, vec3 light_center, float light_radius)
+{
+	vec3 to_light = light_center - position;
+	float light_distance = length(to_light);
+	vec3 light_direction = to_light / light_distance;
+	float light_angle = asin(min(light_radius / light_distance, 1.0));
+
+	// Visits only the BVH nodes intersecting the cone towards the light (the ray towards the light center, the boxes
+	// are enlarged by the radius of the cone at the light).
+	float cone_radius = light_distance * tan(light_angle);
+	vec3 inv_direction = 1.0 / light_direction;
+	float visibility = 1.0;
+	int stack[bvh_max_depth];
+	int stack_size = 0;
+	int node_index = 0;
+	while (true) {
+		BVHNode node = bvh_nodes[node_index];
+		vec3 t1 = (node.bounds_min - cone_radius - position) * inv_direction;
+		vec3 t2 = (node.bounds_max + cone_radius - position) * inv_direction;
+		vec3 t_min = min(t1, t2);
+		vec3 t_max = max(t1, t2);
+		float t_near = max(max(t_min.x, t_min.y), max(t_min.z, 0.0));
+		float t_far = min(min(t_max.x, t_max.y), t_max.z);
+		if (t_near <= t_far && t_near < light_distance) {
+			if (node.count >= 0) {
+				for (int k = node.first; k < node.first + node.count; k++) {
+					vec4 sphere = sphere_positions[bvh_indices[k]];
+					vec3 to_sphere = sphere.xyz - position;
+					float sphere_distance = length(to_sphere);
+
+					// Skips the spheres containing the position (including the one it lies on, whose shadow is given
+					// by the cosine term) and the spheres behind the light.
+					if (sphere_distance <= sphere.w + 1e-2 || sphere_distance - sphere.w >= light_distance)
+						continue;
+
+					float occluder_angle = asin(sphere.w / sphere_distance);
+					float angle_between = acos(clamp(dot(to_sphere / sphere_distance, light_direction), -1.0, 1.0));
+					visibility *= 1.0 - cap_coverage(light_angle, occluder_angle, angle_between);
+				}
+				if (visibility <= 0.0) {
+					return 0.0;
+				}
+			} else {
+				stack[stack_size++] = node.first;
+				node_index = node_index + 1;
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+	return visibility;
+}
@@ -0,0 +1,118 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+in VertexData
+{
+	vec2 tex_coord;
+} in_data;
+
+// The UBO with camera data.
+layout (std140, binding = 0) uniform CameraBuffer
+{
+	mat4 projection;	  // The projection matrix.
+	mat4 projection_inv;  // The inverse of the projection matrix.
+	mat4 view;			  // The view matrix
+	mat4 view_inv;		  // The inverse of the view matrix.
+	mat3 view_it;		  // The inverse of the transpose of the top-left part 3x3 of the view matrix
+	vec3 eye_position;	  // The position of the eye in world space.
+};
+
+// The colors ray traced in the current frame.
+layout (binding = 0) uniform sampler2D current_color_texture;
+// The depth ray traced in the current frame.
+layout (binding = 1) uniform sampler2D current_depth_texture;
+// The colors accumulated until the previous frame.
+layout (binding = 2) uniform sampler2D history_color_texture;
+// The depth ray traced in the previous frame.
+layout (binding = 3) uniform sampler2D history_depth_texture;
+
+// The windows size.
+uniform vec2 resolution;
+// The view matrix of the previous frame.
+uniform mat4 previous_view;
+// The flag determining if the history is valid (it is not in the first accumulated frame or after a resize).
+uniform bool use_history;
+// The weight of the history; the higher weight gives less noise but the changes of the lighting take longer.
+uniform float history_weight;
+
+// The largest relative difference of the distances from the previous eye for which the history is still used.
+const float max_distance_difference = 0.05;
+// The size of the box (in standard deviations of the neighborhood) into which the history is clamped.
+const float clamp_box_size = 1.25;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+// The accumulated color.
+layout (location = 0) out vec4 final_color;
+
+// ----------------------------------------------------------------------------
+// Local Methods
+// ----------------------------------------------------------------------------
+
+// Converts the depth written by HandleDepth in ray_tracing.frag back to the distance from the eye.
+float DepthToDistance(float depth)
+{
+	float near = projection[3][2] / (projection[2][2] - 1.0f);
+	float far = projection[3][2] / (projection[2][2] + 1.0f);
+	return 1.0 / (1.0 / near + depth * (1.0 / far - 1.0 / near));
+}
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	ivec2 max_pixel = ivec2(resolution) - 1;
+	vec3 current = texelFetch(current_color_texture, pixel, 0).rgb;
+	if (!use_history) {
+		final_color = vec4(current, 1.0);
+		return;
+	}
+
+	// Reconstructs the primary hit from its distance along the primary ray (the same ray as in ray_tracing.frag).
+	float aspect_ratio = resolution.x/resolution.y;
+	vec2 uv = (2.0*in_data.tex_coord - 1.0) * vec2(aspect_ratio, 1.0);
+	vec3 direction = normalize(vec3(view_inv * vec4(uv, -1.0, 1.0)) - eye_position);
+	vec3 position = eye_position + DepthToDistance(texelFetch(current_depth_texture, pixel, 0).r) * direction;
+
+	// Projects the hit into the previous frame, the inverse of the ray generation.
+	vec3 previous_position = vec3(previous_view * vec4(position, 1.0));
+	vec2 previous_tex_coord = (previous_position.xy / max(-previous_position.z, 1e-6) / vec2(aspect_ratio, 1.0)) * 0.5 + 0.5;
+	bool valid = previous_position.z < 0.0
+		&& all(greaterThanEqual(previous_tex_coord, vec2(0.0)))
+		&& all(lessThanEqual(previous_tex_coord, vec2(1.0)));
+
+	// Rejects the history of the surfaces that were hidden in the previous frame.
+	ivec2 previous_pixel = clamp(ivec2(previous_tex_coord * resolution), ivec2(0), max_pixel);
+	float previous_distance = DepthToDistance(texelFetch(history_depth_texture, previous_pixel, 0).r);
+	valid = valid && abs(previous_distance - length(previous_position)) <= max_distance_difference * previous_distance;
+
+	if (!valid) {
+		final_color = vec4(current, 1.0);
+		return;
+	}
+
+	// Computes the mean and the standard deviation of the 3x3 neighborhood.
+	vec3 moment1 = vec3(0.0);
+	vec3 moment2 = vec3(0.0);
+	for (int y = -1; y <= 1; y++) {
+		for (int x = -1; x <= 1; x++) {
+			vec3 color = texelFetch(current_color_texture, clamp(pixel + ivec2(x, y), ivec2(0), max_pixel), 0).rgb;
+			moment1 += color;
+			moment2 += color * color;
+		}
+	}
+	vec3 mean = moment1 / 9.0;
+	vec3 deviation = sqrt(max(moment2 / 9.0 - mean * mean, 0.0));
+
+	// Clamps the history into the colors that are plausible in the neighborhood, this removes the ghosting of the
+	// moving lights and of the reprojection errors while the noise of the shadows is still averaged out.
+	vec3 history = texture(history_color_texture, previous_tex_coord).rgb;
+	history = clamp(history, mean - clamp_box_size * deviation, mean + clamp_box_size * deviation);
+
+	final_color = vec4(mix(current, history, history_weight), 1.0);
+}
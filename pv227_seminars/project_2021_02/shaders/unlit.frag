@@ -10,15 +10,24 @@ in VertexData
 	vec2 tex_coord;		  // The vertex texture coordinates.
 } in_data;
 
-// The material data.
-layout (std140, binding = 3) uniform PhongMaterialBuffer
+// The structure holding the information about a single Phong material.
+struct PhongMaterial
 {
     vec3 ambient;     // The ambient part of the material.
     vec3 diffuse;     // The diffuse part of the material.
     float alpha;      // The alpha (transparency) of the material.
     vec3 specular;    // The specular part of the material.
     float shininess;  // The shininess of the material.
-} material;
+};
+
+// The materials of all rasterized instances.
+layout (std430, binding = 8) readonly buffer PhongMaterialBuffer
+{
+    PhongMaterial materials[];
+};
+
+// The index of the material of the instance.
+flat in int material_index;
 
 // The flag determining whether a texture should be used.
 uniform bool has_texture;
@@ -36,6 +45,8 @@ layout (location = 0) out vec4 final_color;
 // ----------------------------------------------------------------------------
 void main()
 {
+	PhongMaterial material = materials[material_index];
+
 	// Extracts the diffuse color either from material or texture depending on the value of has_texture variable. 
 	vec3 color = material.diffuse;
 	if(has_texture){
@@ -0,0 +1,136 @@
+// ----------------------------------------------------------------------------
+// Wavefront Ray Tracing
+// ----------------------------------------------------------------------------
+// The queues shared by the stages of the wavefront ray tracing. The image is traced tile by tile:
+// wavefront_generate.comp fills the ray queue with the primary rays of the tile, and every bounce then runs
+// wavefront_intersect.comp finding the closest hits of the queued rays, wavefront_shade.comp accumulating the emitted
+// light and appending the shadow queries and the reflected rays, wavefront_advance.comp preparing the indirect dispatches
+// of the next stages, and wavefront_shadow.comp tracing the shadow queries. Each stage runs one invocation per item of
+// its queue, hence the invocations of a work group do the same kind of work, and the terminated paths leave the queues.
+//
+// The colors are accumulated in fixed point by integer atomics since the float atomics are only an extension (e.g., they
+// are not available in llvmpipe).
+
+#pragma include ray_tracing.glsl
+
+// The number of invocations in one work group of the wavefront stages.
+#define WAVEFRONT_GROUP_SIZE 64
+
+// A ray of the path traced from one pixel.
+struct WavefrontRay
+{
+	vec3 origin;		// The ray origin.
+	int pixel;			// The index of the pixel (y * width + x).
+	vec3 direction;		// The ray direction.
+	int padding;
+	vec3 attenuation;	// The product of the Fresnel terms along the path.
+	float padding2;
+};
+
+// The closest hit of a ray (see Hit, the roughness of the material is not stored).
+struct WavefrontHit
+{
+	vec3 intersection;	// The intersection point.
+	float t;			// The distance between the ray origin and the intersection point, miss.t for a miss.
+	vec3 normal;		// The surface normal at the intersection point.
+	int light_index;	// The index of the hit light or -1.
+	vec3 diffuse;		// The diffuse color of the material.
+	float padding;
+	vec3 f0;			// The Fresnel reflection at 0 degrees of the material.
+	float padding2;
+};
+
+// The light of one light reflected by the hit of one ray, the light index is lights_count + r for the rectangular lights.
+struct ShadowQuery
+{
+	int ray;	// The index of the ray (and of its hit) in the current ray queue.
+	int light;	// The index of the light.
+};
+
+// The rays traced in the current bounce.
+layout (std430, binding = 14) buffer RayQueue
+{
+	WavefrontRay rays[];
+};
+
+// The reflected rays traced in the next bounce.
+layout (std430, binding = 15) buffer NextRayQueue
+{
+	WavefrontRay next_rays[];
+};
+
+// The hits of the rays in the current ray queue (with the same indices).
+layout (std430, binding = 16) buffer HitQueue
+{
+	WavefrontHit hits[];
+};
+
+// The shadow queries of the current bounce.
+layout (std430, binding = 17) buffer ShadowQueue
+{
+	ShadowQuery shadow_queries[];
+};
+
+// The sizes of the queues and the indirect dispatches of the stages (the layout of DispatchIndirectCommand, w is unused).
+layout (std430, binding = 18) buffer WavefrontCounters
+{
+	uint ray_count;					// The number of rays in the current ray queue.
+	uint next_ray_count;			// The number of rays appended into the next ray queue.
+	uint shadow_query_count;		// The number of shadow queries traced in the current bounce.
+	uint next_shadow_query_count;	// The number of shadow queries appended by the shading.
+	uvec4 ray_dispatch;				// The dispatch of the stages processing the current ray queue.
+	uvec4 shadow_dispatch;			// The dispatch of the stage processing the shadow queries.
+};
+
+// The colors of all pixels in fixed point (three values per pixel, see color_scale).
+layout (std430, binding = 19) buffer WavefrontColors
+{
+	uint accumulated_colors[];
+};
+
+// The depth (x) and the ambient occlusion (y) of the primary hits of all pixels.
+layout (std430, binding = 20) buffer WavefrontPrimaryHits
+{
+	vec2 primary_hits[];
+};
+
+// The scale of the colors stored in fixed point; the sum of the colors of one pixel must stay below 4096.
+const float color_scale = 1048576.0;
+
+// ----------------------------------------------------------------------------
+// Wavefront Methods
+// ----------------------------------------------------------------------------
+// Converts the hit into its stored form.
+WavefrontHit PackHit(Hit hit)
+{
+	return WavefrontHit(hit.intersection, hit.t, hit.normal, hit.light_index, hit.material.diffuse, 0.0, hit.material.f0, 0.0);
+}
+
+// Converts the stored hit back, the missed rays give exactly miss.
+Hit UnpackHit(WavefrontHit hit)
+{
+	return Hit(hit.t, hit.intersection, hit.normal, PBRMaterialData(hit.diffuse, 0.0, hit.f0), hit.light_index);
+}
+
+// Returns the ray of the path (the rays of the paths hit all lights).
+Ray UnpackRay(WavefrontRay ray)
+{
+	return Ray(ray.origin, ray.direction, -1);
+}
+
+// Returns the coordinates of the pixel with the specified index.
+ivec2 PixelCoordinates(int pixel)
+{
+	return ivec2(pixel % int(resolution.x), pixel / int(resolution.x));
+}
+
+// Adds the color to the pixel.
+void AccumulateColor(int pixel, vec3 color)
+{
+	uvec3 fixed_color = uvec3(color * color_scale + 0.5);
+	for (int c = 0; c < 3; c++)
+	{
+		if (fixed_color[c] > 0u)
+			atomicAdd(accumulated_colors[3 * pixel + c], fixed_color[c]);
+	}
+}
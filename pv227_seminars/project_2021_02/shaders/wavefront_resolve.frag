@@ -0,0 +1,43 @@
+#version 450 core
+
+// ----------------------------------------------------------------------------
+// Input Variables
+// ----------------------------------------------------------------------------
+// The colors of all pixels in fixed point (see wavefront.glsl).
+layout (std430, binding = 19) readonly buffer WavefrontColors
+{
+	uint accumulated_colors[];
+};
+
+// The depth (x) and the ambient occlusion (y) of the primary hits of all pixels.
+layout (std430, binding = 20) readonly buffer WavefrontPrimaryHits
+{
+	vec2 primary_hits[];
+};
+
+// The windows size.
+uniform vec2 resolution;
+
+// The scale of the colors stored in fixed point (see wavefront.glsl).
+const float color_scale = 1048576.0;
+
+// ----------------------------------------------------------------------------
+// Output Variables
+// ----------------------------------------------------------------------------
+// The final output color.
+layout (location = 0) out vec4 final_color;
+
+// ----------------------------------------------------------------------------
+// Main Method
+// ----------------------------------------------------------------------------
+// Writes the colors and the depths computed by the wavefront ray tracing (like the main method of ray_tracing.frag).
+void main()
+{
+	ivec2 coordinates = ivec2(gl_FragCoord.xy);
+	int pixel = coordinates.y * int(resolution.x) + coordinates.x;
+
+	vec3 color = vec3(accumulated_colors[3 * pixel], accumulated_colors[3 * pixel + 1], accumulated_colors[3 * pixel + 2]) / color_scale;
+	vec2 primary_hit = primary_hits[pixel];
+	final_color = vec4(color * primary_hit.y, 1.0);
+	gl_FragDepth = primary_hit.x;
+}
@@ -0,0 +1,36 @@
+#include "snowman.hpp"
+#include <cmath>
+#include <cstdlib>
+
+void SnowmanField::add(const Snowman& snowman, const glm::vec3& position, float rotation, float scale) {
+    const float c = cosf(rotation);
+    const float s = sinf(rotation);
+    for (int i = 0; i < snowman_size; i++) {
+        const glm::vec4& sphere = snowman.spheres[i];
+        const glm::vec3 rotated(c * sphere.x + s * sphere.z, sphere.y, -s * sphere.x + c * sphere.z);
+        spheres.push_back(glm::vec4(position + rotated * scale, sphere.w * scale));
+        materials.push_back(snowman.materials[i]);
+    }
+}
+
+SnowmanField SnowmanField::generate(const Snowman& snowman, int count, float spacing) {
+    SnowmanField field;
+    field.spheres.reserve(static_cast<size_t>(count) * snowman_size);
+    field.materials.reserve(static_cast<size_t>(count) * snowman_size);
+
+    // Sets the seed so that the field is always the same for the same count.
+    srand(4242);
+    const int side = static_cast<int>(ceil(sqrt(static_cast<double>(count))));
+    for (int i = 0; i < count; i++) {
+        const int x = i % side - side / 2;
+        const int z = i / side - side / 2;
+        const float rotation = (static_cast<float>(rand()) / static_cast<float>(RAND_MAX) - 0.5f) * 2.0f * glm::radians(60.0f);
+        const float scale = 0.8f + static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 0.4f;
+        if (x == 0 && z == 0) {
+            field.add(snowman, glm::vec3(0.0f));
+        } else {
+            field.add(snowman, glm::vec3(x, 0.0f, z) * spacing, rotation, scale);
+        }
+    }
+    return field;
+}
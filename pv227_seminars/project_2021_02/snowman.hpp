@@ -0,0 +1,51 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "pbr_material_ubo.hpp"
+#include "ubo.hpp"
+#include <vector>
+
+/** The number of spheres forming the snowman. */
+const int snowman_size = 13;
+
+/** The structure defining the snowman. */
+struct Snowman {
+    glm::vec4 spheres[snowman_size];         // The spheres defining the snowman.
+    PBRMaterialData materials[snowman_size]; // The respective materials for each sphere.
+};
+
+/**
+ * The variable-length set of spheres in the scene. It is created by instantiating the template snowman several times.
+ * The data are uploaded into shader storage buffers with the std430 layout:
+ * <code>
+ * layout (std430, binding = 3) readonly buffer SphereBuffer { vec4 sphere_positions[]; };
+ * layout (std430, binding = 4) readonly buffer SphereMaterialBuffer { PBRMaterialData sphere_materials[]; };
+ * </code>
+ */
+struct SnowmanField {
+    std::vector<glm::vec4> spheres;         // The spheres stored as (center, radius).
+    std::vector<PBRMaterialData> materials; // The respective materials for each sphere.
+
+    /** Returns the number of spheres. */
+    int size() const { return static_cast<int>(spheres.size()); }
+
+    /**
+     * Adds a copy of the snowman rotated around the Y axis, scaled, and moved to the specified position.
+     *
+     * @param 	snowman 	The template snowman.
+     * @param 	position	The position of the snowman origin.
+     * @param 	rotation	The rotation around the Y axis (in radians).
+     * @param 	scale   	The uniform scale of the snowman.
+     */
+    void add(const Snowman& snowman, const glm::vec3& position, float rotation = 0.0f, float scale = 1.0f);
+
+    /**
+     * Generates a square grid of snowmen with random rotations and sizes. The snowman at the origin (if any) keeps the
+     * template pose, so a field with one snowman is the original scene.
+     *
+     * @param 	snowman	The template snowman.
+     * @param 	count  	The number of snowmen.
+     * @param 	spacing	The distance between neighboring snowmen.
+     * @return	The generated field.
+     */
+    static SnowmanField generate(const Snowman& snowman, int count, float spacing = 6.0f);
+};
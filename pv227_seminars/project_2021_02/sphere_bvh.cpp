@@ -0,0 +1,150 @@
+#include "sphere_bvh.hpp"
+#include <algorithm>
+
+namespace {
+/** Computes the half of the surface area of a box (the constant factor does not matter for the heuristic). */
+float half_area(const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+    const glm::vec3 size = glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+/** Returns the bin of a centroid along one axis. */
+int bin_index(float centroid, float centroid_min, float scale, int bins) {
+    return std::min(bins - 1, static_cast<int>((centroid - centroid_min) * scale));
+}
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void SphereBVH::build(const glm::vec4* spheres, int count, int leaf_size) {
+    max_leaf_size = std::max(1, leaf_size);
+
+    nodes.clear();
+    indices.resize(count);
+    sphere_min.resize(count);
+    sphere_max.resize(count);
+    for (int i = 0; i < count; i++) {
+        indices[i] = i;
+        sphere_min[i] = glm::vec3(spheres[i]) - spheres[i].w;
+        sphere_max[i] = glm::vec3(spheres[i]) + spheres[i].w;
+    }
+
+    // A complete binary tree with leaves holding at least one sphere has less than 2 * count nodes.
+    nodes.reserve(std::max(1, 2 * count));
+    build_node(0, count, 0);
+
+    sphere_min.clear();
+    sphere_max.clear();
+}
+
+int SphereBVH::build_node(int first, int count, int depth) {
+    glm::vec3 bounds_min(1e30f);
+    glm::vec3 bounds_max(-1e30f);
+    for (int i = first; i < first + count; i++) {
+        bounds_min = glm::min(bounds_min, sphere_min[indices[i]]);
+        bounds_max = glm::max(bounds_max, sphere_max[indices[i]]);
+    }
+
+    const int index = static_cast<int>(nodes.size());
+    nodes.push_back(BVHNode{bounds_min, first, bounds_max, count});
+
+    int axis;
+    float position;
+    if (count <= max_leaf_size || depth + 1 >= max_depth || !find_split(first, count, bounds_min, bounds_max, axis, position)) {
+        return index;
+    }
+
+    // Partitions the spheres by their centroids.
+    int* middle = std::partition(indices.data() + first, indices.data() + first + count,
+                                 [&](int i) { return (sphere_min[i][axis] + sphere_max[i][axis]) * 0.5f < position; });
+    int left_count = static_cast<int>(middle - (indices.data() + first));
+    if (left_count == 0 || left_count == count) {
+        // All centroids fall into the same bin (e.g., identical spheres), splits the range in half.
+        left_count = count / 2;
+    }
+
+    build_node(first, left_count, depth + 1);
+    const int right = build_node(first + left_count, count - left_count, depth + 1);
+
+    // Note that the vector could be reallocated during the recursion, hence the node is accessed again.
+    nodes[index].first = right;
+    nodes[index].count = -1 - axis;
+    return index;
+}
+
+bool SphereBVH::find_split(int first, int count, const glm::vec3& bounds_min, const glm::vec3& bounds_max, int& axis, float& position) const {
+    glm::vec3 centroid_min(1e30f);
+    glm::vec3 centroid_max(-1e30f);
+    for (int i = first; i < first + count; i++) {
+        const glm::vec3 centroid = (sphere_min[indices[i]] + sphere_max[indices[i]]) * 0.5f;
+        centroid_min = glm::min(centroid_min, centroid);
+        centroid_max = glm::max(centroid_max, centroid);
+    }
+
+    // The cost of a leaf relative to the cost of traversing one inner node and intersecting one sphere.
+    float best_cost = static_cast<float>(count);
+    axis = -1;
+
+    for (int a = 0; a < 3; a++) {
+        const float extent = centroid_max[a] - centroid_min[a];
+        if (extent <= 0.0f) {
+            continue;
+        }
+        const float scale = bin_count / extent;
+
+        // Accumulates the spheres into the bins.
+        int bin_counts[bin_count] = {};
+        glm::vec3 bin_min[bin_count];
+        glm::vec3 bin_max[bin_count];
+        std::fill(bin_min, bin_min + bin_count, glm::vec3(1e30f));
+        std::fill(bin_max, bin_max + bin_count, glm::vec3(-1e30f));
+        for (int i = first; i < first + count; i++) {
+            const int sphere = indices[i];
+            const int b = bin_index((sphere_min[sphere][a] + sphere_max[sphere][a]) * 0.5f, centroid_min[a], scale, bin_count);
+            bin_counts[b]++;
+            bin_min[b] = glm::min(bin_min[b], sphere_min[sphere]);
+            bin_max[b] = glm::max(bin_max[b], sphere_max[sphere]);
+        }
+
+        // Sweeps from the right to compute the areas and counts of the right sides.
+        float right_area[bin_count];
+        int right_count[bin_count];
+        glm::vec3 right_min(1e30f), right_max(-1e30f);
+        int accumulated = 0;
+        for (int b = bin_count - 1; b > 0; b--) {
+            right_min = glm::min(right_min, bin_min[b]);
+            right_max = glm::max(right_max, bin_max[b]);
+            accumulated += bin_counts[b];
+            right_area[b] = half_area(right_min, right_max);
+            right_count[b] = accumulated;
+        }
+
+        // Sweeps from the left and evaluates the split after every bin.
+        glm::vec3 left_min(1e30f), left_max(-1e30f);
+        accumulated = 0;
+        for (int b = 0; b < bin_count - 1; b++) {
+            left_min = glm::min(left_min, bin_min[b]);
+            left_max = glm::max(left_max, bin_max[b]);
+            accumulated += bin_counts[b];
+            if (accumulated == 0 || right_count[b + 1] == 0) {
+                continue;
+            }
+            const float cost = 1.0f + (half_area(left_min, left_max) * accumulated + right_area[b + 1] * right_count[b + 1]) / half_area(bounds_min, bounds_max);
+            if (cost < best_cost) {
+                best_cost = cost;
+                axis = a;
+                position = centroid_min[a] + (b + 1) / scale;
+            }
+        }
+    }
+
+    // Large leaves are split even if the heuristic does not recommend it (the leaf size is the hard limit).
+    if (axis < 0 && count > max_leaf_size) {
+        const glm::vec3 extent = centroid_max - centroid_min;
+        axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        position = (centroid_min[axis] + centroid_max[axis]) * 0.5f;
+        return true;
+    }
+    return axis >= 0;
+}
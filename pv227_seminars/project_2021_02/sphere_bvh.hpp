@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * A node of the flattened BVH. The layout matches the std430 layout of the BVHNode structure in
+ * 'shaders/ray_tracing.frag', hence the nodes can be uploaded into a shader storage buffer as they are.
+ *
+ * The nodes are stored in depth-first order, i.e., the left child of an inner node immediately follows its parent.
+ */
+struct BVHNode {
+    /** The minimum corner of the bounding box. */
+    glm::vec3 bounds_min;
+    /** The index of the first sphere index (leaf) or the index of the right child (inner node). */
+    int first;
+    /** The maximum corner of the bounding box. */
+    glm::vec3 bounds_max;
+    /** The number of spheres (leaf), or -1 - split axis (inner node). */
+    int count;
+
+    /** Checks if the node is a leaf. */
+    bool is_leaf() const { return count >= 0; }
+};
+
+/**
+ * The bounding volume hierarchy over spheres defined as (center, radius). It is built on CPU using the binned
+ * surface area heuristic and it is traversed both in the shader and in the CPU ray tracer.
+ */
+class SphereBVH {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+public:
+    /** The maximum depth of the tree; it must fit the traversal stack in the shader. */
+    static const int max_depth = 32;
+
+protected:
+    /** The number of bins used to evaluate the surface area heuristic along each axis. */
+    static const int bin_count = 16;
+
+    /** The flattened nodes, the root is the first one. */
+    std::vector<BVHNode> nodes;
+
+    /** The indices of spheres referenced by the leaves. */
+    std::vector<int> indices;
+
+    /** The bounding boxes of the spheres (used during the build). */
+    std::vector<glm::vec3> sphere_min;
+    std::vector<glm::vec3> sphere_max;
+
+    /** The maximum number of spheres in one leaf. */
+    int max_leaf_size = 4;
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Builds the hierarchy.
+     *
+     * @param 	spheres	 	The spheres stored as (center, radius).
+     * @param 	count	 	The number of spheres.
+     * @param 	leaf_size	The maximum number of spheres in one leaf (it is exceeded only when the depth limit is reached).
+     */
+    void build(const glm::vec4* spheres, int count, int leaf_size = 4);
+
+protected:
+    /** Builds the subtree over indices [first, first + count) and returns the index of its root. */
+    int build_node(int first, int count, int depth);
+
+    /** Finds the best split using the binned surface area heuristic; returns @p false if the node should be a leaf. */
+    bool find_split(int first, int count, const glm::vec3& bounds_min, const glm::vec3& bounds_max, int& axis, float& position) const;
+
+    // ----------------------------------------------------------------------------
+    // Getters & Setters
+    // ----------------------------------------------------------------------------
+public:
+    /** Returns the flattened nodes. */
+    const std::vector<BVHNode>& get_nodes() const { return nodes; }
+
+    /** Returns the indices of spheres referenced by the leaves. */
+    const std::vector<int>& get_indices() const { return indices; }
+};
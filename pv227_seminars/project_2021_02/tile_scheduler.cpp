@@ -0,0 +1,121 @@
+#include "tile_scheduler.hpp"
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+// Constructors
+// ----------------------------------------------------------------------------
+TileScheduler::TileScheduler(unsigned int thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < thread_count; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    // The worker 0 is the thread calling run, hence we start one thread less.
+    for (unsigned int i = 1; i < thread_count; i++) {
+        threads.emplace_back(&TileScheduler::thread_loop, this, static_cast<int>(i));
+    }
+}
+
+TileScheduler::~TileScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        stop = true;
+    }
+    batch_started.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Methods
+// ----------------------------------------------------------------------------
+void TileScheduler::run(int task_count, const std::function<void(int)>& task) {
+    if (task_count <= 0) {
+        return;
+    }
+
+    // Splits the tasks into contiguous ranges so that neighboring tiles stay on the same worker (and in its caches).
+    const int workers = static_cast<int>(queues.size());
+    for (int w = 0; w < workers; w++) {
+        std::lock_guard<std::mutex> lock(queues[w]->mutex);
+        const int first = task_count * w / workers;
+        const int last = task_count * (w + 1) / workers;
+        for (int i = first; i < last; i++) {
+            queues[w]->tasks.push_back(i);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        job = task;
+        busy_threads = static_cast<int>(threads.size());
+        batch++;
+    }
+    batch_started.notify_all();
+
+    // The calling thread works as well.
+    process(0);
+
+    // Waits for the background threads.
+    std::unique_lock<std::mutex> lock(batch_mutex);
+    batch_finished.wait(lock, [this] { return busy_threads == 0; });
+    job = nullptr;
+}
+
+void TileScheduler::process(int worker) {
+    int task;
+    while (next_task(worker, task)) {
+        job(task);
+    }
+}
+
+bool TileScheduler::next_task(int worker, int& task) {
+    // Takes the task from the front of the own queue.
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // Steals the task from the back of the other queues (i.e., the work the owner would process last).
+    const int workers = static_cast<int>(queues.size());
+    for (int i = 1; i < workers; i++) {
+        WorkerQueue& victim = *queues[(worker + i) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TileScheduler::thread_loop(int worker) {
+    uint64_t processed_batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(batch_mutex);
+            batch_started.wait(lock, [&] { return stop || batch != processed_batch; });
+            if (stop) {
+                return;
+            }
+            processed_batch = batch;
+        }
+
+        process(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(batch_mutex);
+            busy_threads--;
+        }
+        batch_finished.notify_one();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A simple work-stealing scheduler that executes independent tasks (e.g., image tiles) on a pool of persistent
+ * threads. Every worker owns a queue with a contiguous range of tasks. It takes the tasks from the front of its own
+ * queue and, when the queue is empty, it steals the tasks from the back of the queues owned by the other workers.
+ *
+ * The thread calling @link TileScheduler::run participates as one of the workers and the method returns once all
+ * tasks are finished.
+ */
+class TileScheduler {
+    // ----------------------------------------------------------------------------
+    // Variables
+    // ----------------------------------------------------------------------------
+protected:
+    /** The queue of tasks owned by a single worker. */
+    struct WorkerQueue {
+        /** The mutex guarding the tasks. */
+        std::mutex mutex;
+        /** The indices of tasks that were not processed yet. */
+        std::deque<int> tasks;
+    };
+
+    /** The background threads (the calling thread acts as the worker with index 0). */
+    std::vector<std::thread> threads;
+
+    /** The task queues, one for each worker. */
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+    /** The function executed for every task in the current batch. */
+    std::function<void(int)> job;
+
+    /** The mutex guarding the batch state below. */
+    std::mutex batch_mutex;
+
+    /** The condition notifying the background threads that a new batch is available. */
+    std::condition_variable batch_started;
+
+    /** The condition notifying the calling thread that all background threads finished the batch. */
+    std::condition_variable batch_finished;
+
+    /** The number of the current batch; the background threads use it to detect new work. */
+    uint64_t batch = 0;
+
+    /** The number of background threads that are still processing the current batch. */
+    int busy_threads = 0;
+
+    /** The flag signaling the background threads to terminate. */
+    bool stop = false;
+
+    // ----------------------------------------------------------------------------
+    // Constructors
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Constructs a new @link TileScheduler and starts its background threads.
+     *
+     * @param 	thread_count	The total number of workers including the calling thread (0 selects the number of cores).
+     */
+    TileScheduler(unsigned int thread_count = 0);
+
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    /** Stops and joins the background threads. */
+    ~TileScheduler();
+
+    // ----------------------------------------------------------------------------
+    // Methods
+    // ----------------------------------------------------------------------------
+public:
+    /**
+     * Executes the specified task for every index from [0, task_count) and waits until all of them are finished.
+     *
+     * @param 	task_count	The number of tasks.
+     * @param 	task	  	The function invoked with the index of each task. It must be safe to call it concurrently.
+     */
+    void run(int task_count, const std::function<void(int)>& task);
+
+    /** Returns the total number of workers including the calling thread. */
+    unsigned int get_worker_count() const { return static_cast<unsigned int>(queues.size()); }
+
+protected:
+    /** Processes the tasks from the own queue and then steals from the others until no task is left. */
+    void process(int worker);
+
+    /** Takes the next task for the specified worker; returns @p false if there is no task left in any queue. */
+    bool next_task(int worker, int& task);
+
+    /** The main loop of a background thread. */
+    void thread_loop(int worker);
+};